@@ -35,8 +35,11 @@
  */
 
 #include "signon-auth-service.h"
+#include "signon-enum-types.h"
 #include "signon-errors.h"
 #include "signon-internals.h"
+#include "signon-dbus-queue.h"
+#include "signon-marshal.h"
 #include "sso-auth-service.h"
 #include <gio/gio.h>
 #include <glib.h>
@@ -47,13 +50,42 @@ struct _SignonAuthServicePrivate
 {
     SsoAuthService *proxy;
     GCancellable *cancellable;
+    SsoDisconnectHook *disconnect_hook;
+    SignonReadyState ready_state;
+    GMainContext *context;
+    GWeakRef *listener;
 };
 
+enum {
+    IDENTITY_CHANGED_SIGNAL,
+    LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
+/*
+ * Log of the identity changes seen by this process, shared by all the
+ * SignonAuthService objects. Only the last IDENTITY_CHANGE_LOG_SIZE are
+ * kept; once signond has been unreachable, change_horizon is the sequence
+ * number up to which the changes may be incomplete (changes that happened
+ * while signond was unreachable are never seen).
+ */
+#define IDENTITY_CHANGE_LOG_SIZE 256
+
+static GMutex change_mutex;
+static SignonIdentityChange change_log[IDENTITY_CHANGE_LOG_SIZE];
+static guint change_sequence = 0;
+static guint change_horizon = 0;
+static gboolean change_horizon_set = FALSE;
+static GList *change_listeners = NULL;
+
 typedef struct _MethodCbData
 {
     SignonAuthService *service;
     SignonQueryMethodsCb cb;
     gpointer userdata;
+    guint generation;
+    gchar **cached;
 } MethodCbData;
 
 typedef struct _MechanismCbData
@@ -62,6 +94,8 @@ typedef struct _MechanismCbData
     SignonQueryMechanismCb cb;
     gpointer userdata;
     gchar *method;
+    guint generation;
+    gchar **cached;
 } MechanismCbData;
 
 typedef struct _IdentityCbData
@@ -69,6 +103,9 @@ typedef struct _IdentityCbData
     SignonAuthService *service;
     SignonQueryIdentitiesCb cb;
     gpointer userdata;
+    GVariant *filter;
+    gchar *application_context;
+    SignonIdentityInfoField fields;
 } IdentityCbData;
 
 typedef struct _ClearCbData
@@ -80,6 +117,204 @@ typedef struct _ClearCbData
 
 #define SIGNON_AUTH_SERVICE_PRIV(obj) (SIGNON_AUTH_SERVICE(obj)->priv)
 
+/*
+ * The available methods and mechanisms only change when the set of plugins
+ * of signond does, that is when it is restarted: they are cached for the
+ * whole process, and dropped when the connection to signond is lost.
+ */
+static GMutex plugin_cache_mutex;
+static guint plugin_cache_generation = 0;
+static gchar **cached_methods = NULL;
+static GHashTable *cached_mechanisms = NULL;
+
+/* must be called with plugin_cache_mutex held */
+static void
+plugin_cache_validate (void)
+{
+    guint generation = sso_auth_service_get_generation ();
+
+    if (G_LIKELY (plugin_cache_generation == generation))
+        return;
+
+    g_strfreev (cached_methods);
+    cached_methods = NULL;
+    if (cached_mechanisms != NULL)
+        g_hash_table_remove_all (cached_mechanisms);
+    plugin_cache_generation = generation;
+}
+
+static gchar **
+plugin_cache_get_methods (void)
+{
+    gchar **methods;
+
+    g_mutex_lock (&plugin_cache_mutex);
+    plugin_cache_validate ();
+    methods = g_strdupv (cached_methods);
+    g_mutex_unlock (&plugin_cache_mutex);
+
+    return methods;
+}
+
+static void
+plugin_cache_set_methods (gchar **methods, guint generation)
+{
+    g_mutex_lock (&plugin_cache_mutex);
+    plugin_cache_validate ();
+    if (generation == plugin_cache_generation)
+    {
+        g_strfreev (cached_methods);
+        cached_methods = g_strdupv (methods);
+    }
+    g_mutex_unlock (&plugin_cache_mutex);
+}
+
+static gchar **
+plugin_cache_get_mechanisms (const gchar *method)
+{
+    gchar **mechanisms = NULL;
+
+    g_mutex_lock (&plugin_cache_mutex);
+    plugin_cache_validate ();
+    if (cached_mechanisms != NULL && method != NULL)
+        mechanisms = g_strdupv (g_hash_table_lookup (cached_mechanisms,
+                                                     method));
+    g_mutex_unlock (&plugin_cache_mutex);
+
+    return mechanisms;
+}
+
+static void
+plugin_cache_set_mechanisms (const gchar *method, gchar **mechanisms,
+                             guint generation)
+{
+    g_mutex_lock (&plugin_cache_mutex);
+    plugin_cache_validate ();
+    if (generation == plugin_cache_generation)
+    {
+        if (cached_mechanisms == NULL)
+            cached_mechanisms =
+                g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                       (GDestroyNotify) g_strfreev);
+        g_hash_table_replace (cached_mechanisms, g_strdup (method),
+                              g_strdupv (mechanisms));
+    }
+    g_mutex_unlock (&plugin_cache_mutex);
+}
+
+static void
+auth_service_proxy_ready_cb (GObject *object, GAsyncResult *res,
+                             gpointer user_data)
+{
+    SignonAuthService *auth_service = (SignonAuthService *)user_data;
+    SsoAuthService *proxy;
+    GError *error = NULL;
+
+    (void)object;
+
+    proxy = sso_auth_service_get_instance_finish (res, &error);
+    if (SIGNON_IS_NOT_CANCELLED (error))
+    {
+        auth_service->priv->proxy = proxy;
+        _signon_object_ready (auth_service, &auth_service->priv->ready_state,
+                              error);
+    }
+    g_clear_error (&error);
+}
+
+typedef struct _IdentityChangedData
+{
+    SignonAuthService *service;
+    SignonIdentityChange change;
+} IdentityChangedData;
+
+static gboolean
+auth_service_emit_identity_changed (gpointer user_data)
+{
+    IdentityChangedData *data = (IdentityChangedData *)user_data;
+
+    g_signal_emit (data->service, signals[IDENTITY_CHANGED_SIGNAL], 0,
+                   data->change.type,
+                   data->change.id,
+                   data->change.sequence);
+
+    g_object_unref (data->service);
+    g_slice_free (IdentityChangedData, data);
+    return FALSE;
+}
+
+void
+_signon_auth_service_identity_changed (SignonIdentityChangeType type,
+                                       guint32 id)
+{
+    SignonIdentityChange change;
+    GMainContext *context;
+    GList *services = NULL;
+    GList *list;
+
+    g_mutex_lock (&change_mutex);
+
+    change.sequence = ++change_sequence;
+    change.type = type;
+    change.id = id;
+    change_log[change.sequence % IDENTITY_CHANGE_LOG_SIZE] = change;
+
+    for (list = change_listeners; list != NULL; list = list->next)
+    {
+        gpointer service = g_weak_ref_get (list->data);
+        if (service != NULL)
+            services = g_list_prepend (services, service);
+    }
+
+    g_mutex_unlock (&change_mutex);
+
+    DEBUG ("%s: %u %d %u", G_STRFUNC, change.sequence, type, id);
+
+    context = g_main_context_ref_thread_default ();
+    for (list = services; list != NULL; list = list->next)
+    {
+        SignonAuthService *service = list->data;
+        IdentityChangedData *data;
+
+        data = g_slice_new (IdentityChangedData);
+        data->service = service;
+        data->change = change;
+
+        /* deliver the signal in the thread the service belongs to */
+        if (service->priv->context == context)
+            auth_service_emit_identity_changed (data);
+        else
+            g_main_context_invoke (service->priv->context,
+                                   auth_service_emit_identity_changed,
+                                   data);
+    }
+    g_main_context_unref (context);
+    g_list_free (services);
+}
+
+static void
+auth_service_disconnected (gpointer user_data)
+{
+    SignonAuthService *auth_service = SIGNON_AUTH_SERVICE (user_data);
+    SignonAuthServicePrivate *priv = auth_service->priv;
+
+    /* identities may change while the daemon is unreachable */
+    g_mutex_lock (&change_mutex);
+    change_horizon = change_sequence;
+    change_horizon_set = TRUE;
+    g_mutex_unlock (&change_mutex);
+
+    if (priv->proxy == NULL)
+        return;
+
+    /* Requests issued from now on are queued until the connection is back */
+    g_clear_object (&priv->proxy);
+    _signon_object_not_ready (&priv->ready_state);
+    sso_auth_service_get_instance_async (priv->cancellable,
+                                         auth_service_proxy_ready_cb,
+                                         auth_service);
+}
+
 static void
 signon_auth_service_init (SignonAuthService *auth_service)
 {
@@ -88,10 +323,29 @@ signon_auth_service_init (SignonAuthService *auth_service)
     priv = G_TYPE_INSTANCE_GET_PRIVATE (auth_service, SIGNON_TYPE_AUTH_SERVICE,
                                         SignonAuthServicePrivate);
     auth_service->priv = priv;
+    _signon_ready_state_init (&priv->ready_state);
+
+    priv->context = g_main_context_ref_thread_default ();
+    priv->listener = g_slice_new (GWeakRef);
+    g_weak_ref_init (priv->listener, auth_service);
+    g_mutex_lock (&change_mutex);
+    change_listeners = g_list_prepend (change_listeners, priv->listener);
+    g_mutex_unlock (&change_mutex);
 
-    /* Create the proxy */
+    /* Create the proxy; if this thread is not connected to signond yet, the
+     * connection is set up asynchronously and the requests are queued until
+     * it is ready */
     priv->cancellable = g_cancellable_new ();
-    priv->proxy = sso_auth_service_get_instance ();
+    priv->disconnect_hook =
+        sso_auth_service_add_disconnect_hook (auth_service_disconnected,
+                                              auth_service);
+    priv->proxy = sso_auth_service_peek_instance ();
+    if (priv->proxy != NULL)
+        _signon_object_ready (auth_service, &priv->ready_state, NULL);
+    else
+        sso_auth_service_get_instance_async (priv->cancellable,
+                                             auth_service_proxy_ready_cb,
+                                             auth_service);
 }
 
 static void
@@ -100,6 +354,22 @@ signon_auth_service_dispose (GObject *object)
     SignonAuthService *auth_service = SIGNON_AUTH_SERVICE (object);
     SignonAuthServicePrivate *priv = auth_service->priv;
 
+    if (priv->disconnect_hook)
+    {
+        sso_auth_service_remove_disconnect_hook (priv->disconnect_hook);
+        priv->disconnect_hook = NULL;
+    }
+
+    if (priv->listener)
+    {
+        g_mutex_lock (&change_mutex);
+        change_listeners = g_list_remove (change_listeners, priv->listener);
+        g_mutex_unlock (&change_mutex);
+        g_weak_ref_clear (priv->listener);
+        g_slice_free (GWeakRef, priv->listener);
+        priv->listener = NULL;
+    }
+
     if (priv->cancellable)
     {
         g_cancellable_cancel (priv->cancellable);
@@ -119,6 +389,11 @@ signon_auth_service_dispose (GObject *object)
 static void
 signon_auth_service_finalize (GObject *object)
 {
+    SignonAuthService *auth_service = SIGNON_AUTH_SERVICE (object);
+
+    _signon_ready_state_clear (&auth_service->priv->ready_state, object);
+    g_main_context_unref (auth_service->priv->context);
+
     G_OBJECT_CLASS (signon_auth_service_parent_class)->finalize (object);
 }
 
@@ -131,12 +406,39 @@ signon_auth_service_class_init (SignonAuthServiceClass *klass)
 
     object_class->dispose = signon_auth_service_dispose;
     object_class->finalize = signon_auth_service_finalize;
+
+    /**
+     * SignonAuthService::identity-changed:
+     * @auth_service: the #SignonAuthService
+     * @type: the #SignonIdentityChangeType
+     * @id: the ID of the identity which changed
+     * @sequence: the sequence number of the change
+     *
+     * Emitted when an identity is stored, updated or removed, either by
+     * this process or, for the identities this process has open, by
+     * another one. Together with
+     * signon_auth_service_get_identity_changes() it allows keeping a list
+     * of identities up to date without querying them all again.
+     */
+    signals[IDENTITY_CHANGED_SIGNAL] =
+        g_signal_new ("identity-changed",
+                      G_TYPE_FROM_CLASS (klass),
+                      G_SIGNAL_RUN_LAST,
+                      0,
+                      NULL,
+                      NULL,
+                      _signon_marshal_VOID__ENUM_UINT_UINT,
+                      G_TYPE_NONE, 3,
+                      SIGNON_TYPE_IDENTITY_CHANGE_TYPE,
+                      G_TYPE_UINT,
+                      G_TYPE_UINT);
 }
 
 /**
  * signon_auth_service_new:
  *
- * Create a new #SignonAuthService.
+ * Create a new #SignonAuthService. The connection to the signon daemon is
+ * established asynchronously; requests issued before it is ready are queued.
  *
  * Returns: an instance of an #SignonAuthService.
  */
@@ -146,6 +448,338 @@ signon_auth_service_new ()
     return g_object_new (SIGNON_TYPE_AUTH_SERVICE, NULL);
 }
 
+static void
+auth_service_new_ready_cb (gpointer object, const GError *error,
+                           gpointer user_data)
+{
+    GSimpleAsyncResult *res = (GSimpleAsyncResult *)user_data;
+
+    (void)object;
+
+    if (error != NULL)
+        g_simple_async_result_set_from_error (res, error);
+
+    g_simple_async_result_complete_in_idle (res);
+    g_object_unref (res);
+}
+
+/**
+ * signon_auth_service_new_async:
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @callback: (scope async): a callback to call when the service is ready.
+ * @user_data: user data for @callback.
+ *
+ * Asynchronously creates a new #SignonAuthService and waits until its
+ * connection to the signon daemon has been established, without blocking the
+ * main loop.
+ * When the operation is finished, @callback will be invoked in the
+ * thread-default main loop of the thread you are calling this method from;
+ * call signon_auth_service_new_finish() from it to get the result.
+ */
+void
+signon_auth_service_new_async (GCancellable *cancellable,
+                               GAsyncReadyCallback callback,
+                               gpointer user_data)
+{
+    SignonAuthService *auth_service;
+    GSimpleAsyncResult *res;
+
+    auth_service = g_object_new (SIGNON_TYPE_AUTH_SERVICE, NULL);
+    res = g_simple_async_result_new (NULL, callback, user_data,
+                                     signon_auth_service_new_async);
+    g_simple_async_result_set_op_res_gpointer (res, auth_service,
+                                               g_object_unref);
+    g_simple_async_result_set_check_cancellable (res, cancellable);
+
+    _signon_object_call_when_ready (auth_service,
+                                    &auth_service->priv->ready_state,
+                                    auth_service_new_ready_cb,
+                                    res);
+}
+
+/**
+ * signon_auth_service_new_finish:
+ * @res: a #GAsyncResult obtained from the callback passed to
+ * signon_auth_service_new_async().
+ * @error: return location for a #GError, or %NULL.
+ *
+ * Finishes an operation started with signon_auth_service_new_async().
+ *
+ * Returns: (transfer full): a new #SignonAuthService, or %NULL if the
+ * connection to the signon daemon could not be established.
+ */
+SignonAuthService *
+signon_auth_service_new_finish (GAsyncResult *res, GError **error)
+{
+    GSimpleAsyncResult *simple;
+
+    g_return_val_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res), NULL);
+    simple = (GSimpleAsyncResult *)res;
+
+    if (g_simple_async_result_propagate_error (simple, error))
+        return NULL;
+
+    return g_object_ref (g_simple_async_result_get_op_res_gpointer (simple));
+}
+
+static void
+auth_service_prewarm_cb (GObject *object, GAsyncResult *res,
+                         gpointer user_data)
+{
+    SsoAuthService *proxy;
+    GError *error = NULL;
+
+    (void)object;
+    (void)user_data;
+
+    proxy = sso_auth_service_get_instance_finish (res, &error);
+    if (G_UNLIKELY (error != NULL))
+    {
+        DEBUG ("%s: %s", G_STRFUNC, error->message);
+        g_error_free (error);
+        return;
+    }
+
+    sso_auth_service_pin_instance (proxy);
+    g_object_unref (proxy);
+}
+
+/**
+ * signon_auth_service_prewarm:
+ * @ids: (array length=n_ids) (allow-none): identity IDs to resolve in advance.
+ * @n_ids: the number of elements in @ids.
+ * @application_context: application security context used for @ids, can be
+ * %NULL.
+ *
+ * Sets up the connection to the signon daemon in the background, so that
+ * applications which authenticate right at startup don't pay for it on
+ * their critical path. The connection is kept open for the lifetime of the
+ * calling thread.
+ *
+ * The identities listed in @ids are registered with the daemon too: the
+ * first subsequent call to signon_identity_new_with_context_from_db() (or
+ * signon_identity_new_from_db(), if @application_context is %NULL) for each
+ * of them returns the already resolved object.
+ *
+ * Like the rest of the library, this must be called from the thread (and
+ * thread-default main context) that will use the objects.
+ */
+void
+signon_auth_service_prewarm (const guint32 *ids, guint n_ids,
+                             const gchar *application_context)
+{
+    guint i;
+
+    g_return_if_fail (ids != NULL || n_ids == 0);
+
+    sso_auth_service_get_instance_async (NULL, auth_service_prewarm_cb, NULL);
+
+    for (i = 0; i < n_ids; i++)
+    {
+        if (ids[i] != 0)
+            _signon_identity_prewarm (ids[i], application_context);
+    }
+}
+
+typedef struct _GetIdentitiesData
+{
+    GSimpleAsyncResult *res;
+    GPtrArray *identities;
+    guint pending;
+} GetIdentitiesData;
+
+typedef struct _GetIdentitiesItemData
+{
+    GetIdentitiesData *data;
+    guint index;
+} GetIdentitiesItemData;
+
+static void
+auth_service_get_identities_complete (GetIdentitiesData *data)
+{
+    g_simple_async_result_set_op_res_gpointer (data->res,
+                                               data->identities,
+                                               (GDestroyNotify)g_ptr_array_unref);
+    g_simple_async_result_complete_in_idle (data->res);
+    g_object_unref (data->res);
+    g_slice_free (GetIdentitiesData, data);
+}
+
+static void
+auth_service_get_identity_ready_cb (gpointer object, const GError *error,
+                                    gpointer user_data)
+{
+    GetIdentitiesItemData *item = (GetIdentitiesItemData *)user_data;
+    GetIdentitiesData *data = item->data;
+
+    if (error != NULL)
+    {
+        DEBUG ("%s: identity %u: %s", G_STRFUNC, item->index, error->message);
+        /* drops the identity */
+        g_ptr_array_index (data->identities, item->index) = NULL;
+        g_object_unref (object);
+    }
+
+    g_slice_free (GetIdentitiesItemData, item);
+
+    if (--data->pending == 0)
+        auth_service_get_identities_complete (data);
+}
+
+/**
+ * signon_auth_service_get_identities_async:
+ * @auth_service: the #SignonAuthService.
+ * @ids: (array length=n_ids): identity IDs to open.
+ * @n_ids: the number of elements in @ids.
+ * @application_context: application security context used for @ids, can be
+ * %NULL.
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @callback: (scope async): a callback to call when all the identities are
+ * ready.
+ * @user_data: user data for @callback.
+ *
+ * Opens several existing identities at once. This is equivalent to calling
+ * signon_identity_new_with_context_from_db() for each of @ids and waiting
+ * for all of them to be registered with the signon daemon, but the
+ * requests are all sent at once instead of one after another.
+ * When the operation is finished, @callback will be invoked in the
+ * thread-default main loop of the thread you are calling this method from;
+ * call signon_auth_service_get_identities_finish() from it to get the
+ * result.
+ */
+void
+signon_auth_service_get_identities_async (SignonAuthService *auth_service,
+                                          const guint32 *ids,
+                                          guint n_ids,
+                                          const gchar *application_context,
+                                          GCancellable *cancellable,
+                                          GAsyncReadyCallback callback,
+                                          gpointer user_data)
+{
+    GetIdentitiesData *data;
+    guint i;
+
+    g_return_if_fail (SIGNON_IS_AUTH_SERVICE (auth_service));
+    g_return_if_fail (ids != NULL || n_ids == 0);
+
+    data = g_slice_new0 (GetIdentitiesData);
+    data->res =
+        g_simple_async_result_new ((GObject *)auth_service, callback, user_data,
+                                   signon_auth_service_get_identities_async);
+    g_simple_async_result_set_check_cancellable (data->res, cancellable);
+    data->identities = g_ptr_array_new_full (n_ids, g_object_unref);
+
+    /* every identity gets its own entry before any request is issued, as
+     * the ready callbacks may run synchronously */
+    for (i = 0; i < n_ids; i++)
+    {
+        SignonIdentity *identity;
+
+        identity = signon_identity_new_with_context_from_db (ids[i],
+                                                             application_context);
+        g_ptr_array_add (data->identities, identity);
+        if (identity != NULL)
+            data->pending++;
+    }
+
+    /* keep the operation alive until the loop below is done */
+    data->pending++;
+
+    for (i = 0; i < n_ids; i++)
+    {
+        GetIdentitiesItemData *item;
+        SignonIdentity *identity;
+
+        identity = g_ptr_array_index (data->identities, i);
+        if (identity == NULL)
+            continue;
+
+        item = g_slice_new (GetIdentitiesItemData);
+        item->data = data;
+        item->index = i;
+        _signon_identity_call_when_ready (identity,
+                                          auth_service_get_identity_ready_cb,
+                                          item);
+    }
+
+    if (--data->pending == 0)
+        auth_service_get_identities_complete (data);
+}
+
+/**
+ * signon_auth_service_get_identities_finish:
+ * @auth_service: the #SignonAuthService.
+ * @res: a #GAsyncResult obtained from the callback passed to
+ * signon_auth_service_get_identities_async().
+ * @error: return location for a #GError, or %NULL.
+ *
+ * Finishes an operation started with
+ * signon_auth_service_get_identities_async().
+ *
+ * Returns: (transfer full): (element-type SignonIdentity): an array with
+ * one element for each of the requested IDs, in the same order: the
+ * #SignonIdentity, or %NULL if it could not be opened (for instance,
+ * because it does not exist). Returns %NULL if the operation failed or was
+ * cancelled.
+ */
+GPtrArray *
+signon_auth_service_get_identities_finish (SignonAuthService *auth_service,
+                                           GAsyncResult *res,
+                                           GError **error)
+{
+    GSimpleAsyncResult *simple;
+
+    g_return_val_if_fail (g_simple_async_result_is_valid (res,
+                              (GObject *)auth_service,
+                              signon_auth_service_get_identities_async),
+                          NULL);
+    simple = (GSimpleAsyncResult *)res;
+
+    if (g_simple_async_result_propagate_error (simple, error))
+        return NULL;
+
+    return g_ptr_array_ref (g_simple_async_result_get_op_res_gpointer (simple));
+}
+
+/* Cached answers are delivered from the main loop, like the others */
+static void
+auth_service_call_in_idle (GSourceFunc func, gpointer data)
+{
+    GSource *source;
+
+    source = g_idle_source_new ();
+    g_source_set_callback (source, func, data, NULL);
+    g_source_attach (source, g_main_context_get_thread_default ());
+    g_source_unref (source);
+}
+
+static gboolean
+auth_query_methods_cached_cb (gpointer user_data)
+{
+    MethodCbData *data = (MethodCbData*)user_data;
+
+    (data->cb)
+        (data->service, data->cached, NULL, data->userdata);
+
+    g_object_unref (data->service);
+    g_slice_free (MethodCbData, data);
+    return FALSE;
+}
+
+static gboolean
+auth_query_mechanisms_cached_cb (gpointer user_data)
+{
+    MechanismCbData *data = (MechanismCbData*)user_data;
+
+    (data->cb)
+        (data->service, data->method, data->cached, NULL, data->userdata);
+
+    g_object_unref (data->service);
+    g_free (data->method);
+    g_slice_free (MechanismCbData, data);
+    return FALSE;
+}
+
 static void
 auth_query_methods_cb (GObject *object, GAsyncResult *res,
                        gpointer user_data)
@@ -159,6 +793,9 @@ auth_query_methods_cb (GObject *object, GAsyncResult *res,
 
     sso_auth_service_call_query_methods_finish (proxy, &value,
                                                 res, &error);
+    if (error == NULL)
+        plugin_cache_set_methods (value, data->generation);
+
     (data->cb)
         (data->service, value, error, data->userdata);
 
@@ -166,6 +803,27 @@ auth_query_methods_cb (GObject *object, GAsyncResult *res,
     g_slice_free (MethodCbData, data);
 }
 
+static void
+auth_query_methods_ready_cb (gpointer object, const GError *error,
+                             gpointer user_data)
+{
+    SignonAuthService *auth_service = SIGNON_AUTH_SERVICE (object);
+    MethodCbData *data = (MethodCbData*)user_data;
+
+    if (error)
+    {
+        (data->cb) (data->service, NULL, error, data->userdata);
+        g_slice_free (MethodCbData, data);
+        return;
+    }
+
+    data->generation = sso_auth_service_get_generation ();
+    sso_auth_service_call_query_methods (auth_service->priv->proxy,
+                                         auth_service->priv->cancellable,
+                                         auth_query_methods_cb,
+                                         data);
+}
+
 static void
 auth_query_mechanisms_cb (GObject *object, GAsyncResult *res,
                           gpointer user_data)
@@ -179,6 +837,9 @@ auth_query_mechanisms_cb (GObject *object, GAsyncResult *res,
 
     sso_auth_service_call_query_mechanisms_finish (proxy, &value,
                                                    res, &error);
+    if (error == NULL && data->method != NULL)
+        plugin_cache_set_mechanisms (data->method, value, data->generation);
+
     (data->cb)
         (data->service, data->method, value, error, data->userdata);
 
@@ -188,6 +849,29 @@ auth_query_mechanisms_cb (GObject *object, GAsyncResult *res,
     g_slice_free (MechanismCbData, data);
 }
 
+static void
+auth_query_mechanisms_ready_cb (gpointer object, const GError *error,
+                                gpointer user_data)
+{
+    SignonAuthService *auth_service = SIGNON_AUTH_SERVICE (object);
+    MechanismCbData *data = (MechanismCbData*)user_data;
+
+    if (error)
+    {
+        (data->cb) (data->service, data->method, NULL, error, data->userdata);
+        g_free (data->method);
+        g_slice_free (MechanismCbData, data);
+        return;
+    }
+
+    data->generation = sso_auth_service_get_generation ();
+    sso_auth_service_call_query_mechanisms (auth_service->priv->proxy,
+                                            data->method,
+                                            auth_service->priv->cancellable,
+                                            auth_query_mechanisms_cb,
+                                            data);
+}
+
 /**
  * SignonQueryMethodsCb:
  * @auth_service: the #SignonAuthService.
@@ -205,28 +889,34 @@ auth_query_mechanisms_cb (GObject *object, GAsyncResult *res,
  * @user_data: user data.
  *
  * Lists all the available authentication methods.
+ * The result is remembered: see signon_auth_service_get_cached_methods().
  */
 void
 signon_auth_service_query_methods (SignonAuthService *auth_service,
                                    SignonQueryMethodsCb cb,
                                    gpointer user_data)
 {
-    SignonAuthServicePrivate *priv;
-
     g_return_if_fail (SIGNON_IS_AUTH_SERVICE (auth_service));
     g_return_if_fail (cb != NULL);
-    priv = SIGNON_AUTH_SERVICE_PRIV (auth_service);
 
     MethodCbData *cb_data;
-    cb_data = g_slice_new (MethodCbData);
+    cb_data = g_slice_new0 (MethodCbData);
     cb_data->service = auth_service;
     cb_data->cb = cb;
     cb_data->userdata = user_data;
 
-    sso_auth_service_call_query_methods (priv->proxy,
-                                         priv->cancellable,
-                                         auth_query_methods_cb,
-                                         cb_data);
+    cb_data->cached = plugin_cache_get_methods ();
+    if (cb_data->cached != NULL)
+    {
+        g_object_ref (auth_service);
+        auth_service_call_in_idle (auth_query_methods_cached_cb, cb_data);
+        return;
+    }
+
+    _signon_object_call_when_ready (auth_service,
+                                    &auth_service->priv->ready_state,
+                                    auth_query_methods_ready_cb,
+                                    cb_data);
 }
 
 /**
@@ -249,6 +939,7 @@ signon_auth_service_query_methods (SignonAuthService *auth_service,
  * @user_data: user data.
  *
  * Lists all the available mechanisms for an authentication method.
+ * The result is remembered: see signon_auth_service_get_cached_mechanisms().
  */
 void
 signon_auth_service_query_mechanisms (SignonAuthService *auth_service,
@@ -256,28 +947,415 @@ signon_auth_service_query_mechanisms (SignonAuthService *auth_service,
                                       SignonQueryMechanismCb cb,
                                       gpointer user_data)
 {
-    SignonAuthServicePrivate *priv;
-
     g_return_if_fail (SIGNON_IS_AUTH_SERVICE (auth_service));
     g_return_if_fail (cb != NULL);
-    priv = SIGNON_AUTH_SERVICE_PRIV (auth_service);
 
     MechanismCbData *cb_data;
-    cb_data = g_slice_new (MechanismCbData);
+    cb_data = g_slice_new0 (MechanismCbData);
     cb_data->service = auth_service;
     cb_data->cb = cb;
     cb_data->userdata = user_data;
     cb_data->method = g_strdup (method);
 
-    sso_auth_service_call_query_mechanisms (priv->proxy,
-                                            method,
-                                            priv->cancellable,
-                                            auth_query_mechanisms_cb,
-                                            cb_data);
+    cb_data->cached = plugin_cache_get_mechanisms (method);
+    if (cb_data->cached != NULL)
+    {
+        g_object_ref (auth_service);
+        auth_service_call_in_idle (auth_query_mechanisms_cached_cb, cb_data);
+        return;
+    }
+
+    _signon_object_call_when_ready (auth_service,
+                                    &auth_service->priv->ready_state,
+                                    auth_query_mechanisms_ready_cb,
+                                    cb_data);
 }
 
-static void
-auth_query_identities_cb (GObject *object, GAsyncResult *res,
+/**
+ * signon_auth_service_get_cached_methods:
+ * @auth_service: the #SignonAuthService.
+ *
+ * Get the list of available authentication methods without contacting
+ * the gSSO daemon, if it is already known: it is remembered after the
+ * first successful signon_auth_service_query_methods() call, until the
+ * daemon is restarted.
+ *
+ * Returns: (transfer full) (type GStrv): the list of available methods,
+ * or %NULL if it is not known yet.
+ */
+gchar **
+signon_auth_service_get_cached_methods (SignonAuthService *auth_service)
+{
+    g_return_val_if_fail (SIGNON_IS_AUTH_SERVICE (auth_service), NULL);
+
+    return plugin_cache_get_methods ();
+}
+
+/**
+ * signon_auth_service_get_cached_mechanisms:
+ * @auth_service: the #SignonAuthService.
+ * @method: the name of a method.
+ *
+ * Get the list of mechanisms of @method without contacting the gSSO
+ * daemon, if it is already known: see
+ * signon_auth_service_get_cached_methods().
+ *
+ * Returns: (transfer full) (type GStrv): the list of available mechanisms,
+ * or %NULL if it is not known yet.
+ */
+gchar **
+signon_auth_service_get_cached_mechanisms (SignonAuthService *auth_service,
+                                           const gchar *method)
+{
+    g_return_val_if_fail (SIGNON_IS_AUTH_SERVICE (auth_service), NULL);
+    g_return_val_if_fail (method != NULL, NULL);
+
+    return plugin_cache_get_mechanisms (method);
+}
+
+/**
+ * signon_identity_filter_new:
+ *
+ * Creates an empty #SignonIdentityFilter, matching all the identities.
+ * The same filter can be used for any number of queries.
+ *
+ * Returns: (transfer full): a new #SignonIdentityFilter; free it with
+ * signon_identity_filter_free().
+ */
+SignonIdentityFilter *
+signon_identity_filter_new (void)
+{
+    return g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                  (GDestroyNotify) g_variant_unref);
+}
+
+/**
+ * signon_identity_filter_free:
+ * @filter: the #SignonIdentityFilter.
+ *
+ * Destroys @filter.
+ */
+void
+signon_identity_filter_free (SignonIdentityFilter *filter)
+{
+    if (filter != NULL)
+        g_hash_table_unref (filter);
+}
+
+static void
+identity_filter_set (SignonIdentityFilter *filter, const gchar *key,
+                     GVariant *value)
+{
+    g_hash_table_replace (filter, g_strdup (key), g_variant_ref_sink (value));
+}
+
+/**
+ * signon_identity_filter_set_owner:
+ * @filter: the #SignonIdentityFilter.
+ * @owner: (transfer none): a security context.
+ *
+ * Only match the identities owned by @owner. See
+ * signon_auth_service_query_identities() for when this applies.
+ */
+void
+signon_identity_filter_set_owner (SignonIdentityFilter *filter,
+                                  const SignonSecurityContext *owner)
+{
+    g_return_if_fail (filter != NULL);
+    g_return_if_fail (owner != NULL);
+
+    identity_filter_set (filter, SIGNOND_IDENTITY_FILTER_OWNER,
+                         signon_security_context_build_variant (owner));
+}
+
+/**
+ * signon_identity_filter_set_type:
+ * @filter: the #SignonIdentityFilter.
+ * @type: a #SignonIdentityType.
+ *
+ * Only match the identities of type @type.
+ */
+void
+signon_identity_filter_set_type (SignonIdentityFilter *filter,
+                                 SignonIdentityType type)
+{
+    g_return_if_fail (filter != NULL);
+
+    identity_filter_set (filter, SIGNOND_IDENTITY_FILTER_TYPE,
+                         g_variant_new_int32 (type));
+}
+
+/**
+ * signon_identity_filter_set_caption:
+ * @filter: the #SignonIdentityFilter.
+ * @caption_prefix: the beginning of the caption.
+ *
+ * Only match the identities whose caption begins with @caption_prefix.
+ */
+void
+signon_identity_filter_set_caption (SignonIdentityFilter *filter,
+                                    const gchar *caption_prefix)
+{
+    g_return_if_fail (filter != NULL);
+    g_return_if_fail (caption_prefix != NULL);
+
+    identity_filter_set (filter, SIGNOND_IDENTITY_FILTER_CAPTION,
+                         g_variant_new_string (caption_prefix));
+}
+
+/**
+ * signon_identity_filter_set_id_range:
+ * @filter: the #SignonIdentityFilter.
+ * @min_id: the lowest matching identity ID.
+ * @max_id: the highest matching identity ID.
+ *
+ * Only match the identities whose ID is between @min_id and @max_id,
+ * inclusive.
+ */
+void
+signon_identity_filter_set_id_range (SignonIdentityFilter *filter,
+                                     guint32 min_id,
+                                     guint32 max_id)
+{
+    g_return_if_fail (filter != NULL);
+    g_return_if_fail (min_id <= max_id);
+
+    identity_filter_set (filter, SIGNOND_IDENTITY_FILTER_ID_RANGE,
+                         g_variant_new ("(uu)", min_id, max_id));
+}
+
+/**
+ * signon_identity_filter_set_method:
+ * @filter: the #SignonIdentityFilter.
+ * @method: an authentication method.
+ *
+ * Only match the identities which allow @method.
+ */
+void
+signon_identity_filter_set_method (SignonIdentityFilter *filter,
+                                   const gchar *method)
+{
+    g_return_if_fail (filter != NULL);
+    g_return_if_fail (method != NULL);
+
+    identity_filter_set (filter, SIGNOND_IDENTITY_FILTER_METHOD,
+                         g_variant_new_string (method));
+}
+
+/**
+ * signon_identity_filter_set_realm:
+ * @filter: the #SignonIdentityFilter.
+ * @realm: a realm.
+ *
+ * Only match the identities which can be used in @realm.
+ */
+void
+signon_identity_filter_set_realm (SignonIdentityFilter *filter,
+                                  const gchar *realm)
+{
+    g_return_if_fail (filter != NULL);
+    g_return_if_fail (realm != NULL);
+
+    identity_filter_set (filter, SIGNOND_IDENTITY_FILTER_REALM,
+                         g_variant_new_string (realm));
+}
+
+/**
+ * signon_identity_filter_set_acl_member:
+ * @filter: the #SignonIdentityFilter.
+ * @context: (transfer none): a security context.
+ *
+ * Only match the identities whose access control list contains @context.
+ */
+void
+signon_identity_filter_set_acl_member (SignonIdentityFilter *filter,
+                                       const SignonSecurityContext *context)
+{
+    g_return_if_fail (filter != NULL);
+    g_return_if_fail (context != NULL);
+
+    identity_filter_set (filter, SIGNOND_IDENTITY_FILTER_ACL_MEMBER,
+                         signon_security_context_build_variant (context));
+}
+
+/**
+ * signon_identity_filter_set_type_mask:
+ * @filter: the #SignonIdentityFilter.
+ * @types: a combination of #SignonIdentityType flags.
+ *
+ * Only match the identities whose type is one of @types.
+ * %SIGNON_IDENTITY_TYPE_OTHER identities never match.
+ */
+void
+signon_identity_filter_set_type_mask (SignonIdentityFilter *filter,
+                                      guint types)
+{
+    g_return_if_fail (filter != NULL);
+
+    identity_filter_set (filter, SIGNOND_IDENTITY_FILTER_TYPE_MASK,
+                         g_variant_new_uint32 (types));
+}
+
+/*
+ * The daemon may not support the newer filter keys: they are checked again
+ * on the serialized identities it returns, before anything is decoded.
+ * auth_service_build_filter() always asks for the fields checked here, so a
+ * field missing from the reply is empty and doesn't match.
+ */
+static gboolean
+identity_filter_match (GVariant *filter, GVariant *identity)
+{
+    GVariant *value;
+    guint32 min_id, max_id, id;
+    guint32 type_mask;
+    const gchar *string;
+    const gchar *system_context;
+    const gchar *application_context;
+
+    if (g_variant_lookup (filter, SIGNOND_IDENTITY_FILTER_ID_RANGE, "(uu)",
+                          &min_id, &max_id) &&
+        (!g_variant_lookup (identity, SIGNOND_IDENTITY_INFO_ID, "u", &id) ||
+         id < min_id || id > max_id))
+        return FALSE;
+
+    if (g_variant_lookup (filter, SIGNOND_IDENTITY_FILTER_METHOD, "&s",
+                          &string))
+    {
+        GVariant *mechanisms = NULL;
+
+        value = g_variant_lookup_value (identity,
+                                        SIGNOND_IDENTITY_INFO_AUTHMETHODS,
+                                        G_VARIANT_TYPE ("a{sas}"));
+        if (value != NULL)
+        {
+            mechanisms = g_variant_lookup_value (value, string, NULL);
+            g_variant_unref (value);
+        }
+        if (mechanisms == NULL)
+            return FALSE;
+        g_variant_unref (mechanisms);
+    }
+
+    if (g_variant_lookup (filter, SIGNOND_IDENTITY_FILTER_REALM, "&s",
+                          &string))
+    {
+        gboolean found = FALSE;
+
+        value = g_variant_lookup_value (identity,
+                                        SIGNOND_IDENTITY_INFO_REALMS,
+                                        G_VARIANT_TYPE_STRING_ARRAY);
+        if (value != NULL)
+        {
+            const gchar **realms = g_variant_get_strv (value, NULL);
+            guint i;
+
+            for (i = 0; realms[i] != NULL && !found; i++)
+                found = (g_strcmp0 (realms[i], string) == 0);
+
+            g_free (realms);
+            g_variant_unref (value);
+        }
+        if (!found)
+            return FALSE;
+    }
+
+    if (g_variant_lookup (filter, SIGNOND_IDENTITY_FILTER_ACL_MEMBER, "(&s&s)",
+                          &system_context, &application_context))
+    {
+        gboolean found = FALSE;
+
+        value = g_variant_lookup_value (identity,
+                                        SIGNOND_IDENTITY_INFO_ACL,
+                                        G_VARIANT_TYPE ("a(ss)"));
+        if (value != NULL)
+        {
+            GVariantIter iter;
+            const gchar *acl_system_context;
+            const gchar *acl_application_context;
+
+            g_variant_iter_init (&iter, value);
+            while (!found &&
+                   g_variant_iter_next (&iter, "(&s&s)", &acl_system_context,
+                                        &acl_application_context))
+            {
+                found = (g_strcmp0 (acl_system_context, system_context) == 0 &&
+                         g_strcmp0 (acl_application_context,
+                                    application_context) == 0);
+            }
+
+            g_variant_unref (value);
+        }
+        if (!found)
+            return FALSE;
+    }
+
+    if (g_variant_lookup (filter, SIGNOND_IDENTITY_FILTER_TYPE_MASK, "u",
+                          &type_mask))
+    {
+        guint32 type = 0;
+
+        value = g_variant_lookup_value (identity,
+                                        SIGNOND_IDENTITY_INFO_TYPE,
+                                        NULL);
+        if (value != NULL)
+        {
+            if (g_variant_is_of_type (value, G_VARIANT_TYPE_UINT32))
+                type = g_variant_get_uint32 (value);
+            else if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT32))
+                type = g_variant_get_int32 (value);
+            g_variant_unref (value);
+        }
+        if ((type & type_mask) == 0)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * The fields identity_filter_match() checks are requested from the daemon
+ * along with @fields, even if the caller doesn't want them decoded.
+ */
+static GVariant *
+auth_service_build_filter (SignonIdentityFilter *filter,
+                           SignonIdentityInfoField fields)
+{
+    GVariantBuilder builder;
+    GHashTableIter iter;
+    const gchar *key;
+    GVariant *value;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+    if (filter)
+    {
+        g_hash_table_iter_init (&iter, filter);
+        while (g_hash_table_iter_next (&iter,
+                                       (gpointer) &key,
+                                       (gpointer) &value))
+        {
+            g_variant_builder_add (&builder, "{sv}", key, value);
+
+            if (g_strcmp0 (key, SIGNOND_IDENTITY_FILTER_ID_RANGE) == 0)
+                fields |= SIGNON_IDENTITY_INFO_FIELD_ID;
+            else if (g_strcmp0 (key, SIGNOND_IDENTITY_FILTER_METHOD) == 0)
+                fields |= SIGNON_IDENTITY_INFO_FIELD_METHODS;
+            else if (g_strcmp0 (key, SIGNOND_IDENTITY_FILTER_REALM) == 0)
+                fields |= SIGNON_IDENTITY_INFO_FIELD_REALMS;
+            else if (g_strcmp0 (key, SIGNOND_IDENTITY_FILTER_ACL_MEMBER) == 0)
+                fields |= SIGNON_IDENTITY_INFO_FIELD_ACL;
+            else if (g_strcmp0 (key, SIGNOND_IDENTITY_FILTER_TYPE_MASK) == 0)
+                fields |= SIGNON_IDENTITY_INFO_FIELD_TYPE;
+        }
+    }
+    if (fields != SIGNON_IDENTITY_INFO_FIELD_ALL)
+        g_variant_builder_add (&builder, "{sv}",
+                               SIGNOND_IDENTITY_FILTER_FIELDS,
+                               signon_identity_info_fields_to_variant (fields));
+    return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static void
+auth_query_identities_cb (GObject *object, GAsyncResult *res,
                           gpointer user_data)
 {
     SsoAuthService *proxy = SSO_AUTH_SERVICE (object);
@@ -300,20 +1378,56 @@ auth_query_identities_cb (GObject *object, GAsyncResult *res,
         g_variant_iter_init (&iter, value);
         while (g_variant_iter_next (&iter, "@a{sv}", &identity_var))
         {
-            identity_list = 
-                g_list_append (identity_list,
-                               signon_identity_info_new_from_variant (identity_var));
+            if (!identity_filter_match (data->filter, identity_var))
+            {
+                g_variant_unref (identity_var);
+                continue;
+            }
+            identity_list =
+                g_list_prepend (identity_list,
+                                signon_identity_info_new_from_variant_fields (identity_var,
+                                                                              data->fields));
             g_variant_unref (identity_var);
         }
+        identity_list = g_list_reverse (identity_list);
     }
     (data->cb)
         (data->service, identity_list, error, data->userdata);
 
+    if (value)
+        g_variant_unref (value);
     if (error)
         g_error_free (error);
+    g_variant_unref (data->filter);
     g_slice_free (IdentityCbData, data);
 }
 
+static void
+auth_query_identities_ready_cb (gpointer object, const GError *error,
+                                gpointer user_data)
+{
+    SignonAuthService *auth_service = SIGNON_AUTH_SERVICE (object);
+    IdentityCbData *data = (IdentityCbData *) user_data;
+
+    if (error)
+    {
+        (data->cb) (data->service, NULL, error, data->userdata);
+        g_variant_unref (data->filter);
+        g_free (data->application_context);
+        g_slice_free (IdentityCbData, data);
+        return;
+    }
+
+    sso_auth_service_call_query_identities (auth_service->priv->proxy,
+                                            data->filter,
+                                            data->application_context,
+                                            auth_service->priv->cancellable,
+                                            auth_query_identities_cb,
+                                            data);
+    g_free (data->application_context);
+    data->application_context = NULL;
+}
+
 /**
  * SignonQueryIdentitiesCb:
  * @auth_service: the #SignonAuthService.
@@ -345,6 +1459,11 @@ auth_query_identities_cb (GObject *object, GAsyncResult *res,
  * - "Type". The value should be a #SignonIdentityType.
  * - "Caption". The value is a string, and only those identites whose caption
  * begins with the supplied value will be returned.
+ *
+ * The filter is best built with signon_identity_filter_new() and the
+ * signon_identity_filter_set_*() functions, which also support selecting
+ * identities by ID range, method, realm, access control list member and
+ * set of types.
  * 
  * The meaning of @application_context is explained in #SignonSecurityContext.
  * It is used by #GSignondAccessControlManager to determine if the requesting 
@@ -364,16 +1483,43 @@ signon_auth_service_query_identities (SignonAuthService *auth_service,
                                       SignonQueryIdentitiesCb cb,
                                       gpointer user_data)
 {
-    SignonAuthServicePrivate *priv;
-    GVariantBuilder builder;
-    GHashTableIter iter;
-    const gchar *key;
-    GVariant *value;
-    GVariant *filter_var;
+    signon_auth_service_query_identities_with_fields (auth_service,
+                                                      filter,
+                                                      application_context,
+                                                      SIGNON_IDENTITY_INFO_FIELD_ALL,
+                                                      cb,
+                                                      user_data);
+}
 
+/**
+ * signon_auth_service_query_identities_with_fields:
+ * @auth_service: the #SignonAuthService.
+ * @filter: filter variant dictionary based on #GHashTable.
+ * @application_context: application security context, can be %NULL.
+ * @fields: the #SignonIdentityInfoField flags of the fields to retrieve.
+ * @cb: (scope async): callback to be invoked.
+ * @user_data: user data.
+ *
+ * Query available identities like signon_auth_service_query_identities(),
+ * but only retrieve the given @fields of each of them: for instance, a list
+ * of identities usually only needs %SIGNON_IDENTITY_INFO_FIELD_ID,
+ * %SIGNON_IDENTITY_INFO_FIELD_CAPTION and %SIGNON_IDENTITY_INFO_FIELD_TYPE.
+ * The other fields of the returned #SignonIdentityInfo items are left
+ * empty.
+ *
+ * The selection is passed on to the gSSO daemon so that it can leave the
+ * other fields out of its reply.
+ */
+void
+signon_auth_service_query_identities_with_fields (SignonAuthService *auth_service,
+                                                  SignonIdentityFilter *filter,
+                                                  const gchar *application_context,
+                                                  SignonIdentityInfoField fields,
+                                                  SignonQueryIdentitiesCb cb,
+                                                  gpointer user_data)
+{
     g_return_if_fail (SIGNON_IS_AUTH_SERVICE (auth_service));
     g_return_if_fail (cb != NULL);
-    priv = SIGNON_AUTH_SERVICE_PRIV (auth_service);
 
     IdentityCbData *cb_data;
     cb_data = g_slice_new (IdentityCbData);
@@ -381,28 +1527,283 @@ signon_auth_service_query_identities (SignonAuthService *auth_service,
     cb_data->cb = cb;
     cb_data->userdata = user_data;
 
-    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
-    if (filter)
-    {
-        g_hash_table_iter_init (&iter, filter);
-        while (g_hash_table_iter_next (&iter,
-                                       (gpointer) &key,
-                                       (gpointer) &value))
-            g_variant_builder_add (&builder, "{sv}", key, value);
-    }
-    filter_var = g_variant_builder_end (&builder);
+    cb_data->fields = fields;
+    cb_data->filter = auth_service_build_filter (filter, fields);
 
     if (!application_context)
         application_context = "";
+    cb_data->application_context = g_strdup (application_context);
 
-    sso_auth_service_call_query_identities (priv->proxy,
-                                            filter_var,
-                                            application_context,
-                                            priv->cancellable,
-                                            auth_query_identities_cb,
-                                            cb_data);
+    _signon_object_call_when_ready (auth_service,
+                                    &auth_service->priv->ready_state,
+                                    auth_query_identities_ready_cb,
+                                    cb_data);
+}
+
+
+/* Number of identities delivered per main loop iteration by
+ * signon_auth_service_query_identities_stream() */
+#define QUERY_IDENTITIES_CHUNK 64
+
+typedef struct _IdentityStreamData
+{
+    SignonAuthService *service;
+    SignonQueryIdentitiesStreamCb cb;
+    gpointer userdata;
+    GVariant *filter;
+    gchar *application_context;
+    guint offset;
+    guint limit;
+    GVariant *identities;
+    GVariantIter iter;
+    guint position;
+    guint delivered;
+} IdentityStreamData;
+
+static void
+identity_stream_data_free (IdentityStreamData *data)
+{
+    if (data->filter)
+        g_variant_unref (data->filter);
+    g_free (data->application_context);
+    if (data->identities)
+        g_variant_unref (data->identities);
+    g_object_unref (data->service);
+    g_slice_free (IdentityStreamData, data);
+}
+
+static gboolean
+auth_query_identities_stream_idle (gpointer user_data)
+{
+    IdentityStreamData *data = (IdentityStreamData *) user_data;
+    GVariant *identity_var;
+    guint n;
+
+    for (n = 0; n < QUERY_IDENTITIES_CHUNK; n++)
+    {
+        SignonIdentityInfo *info;
+
+        if (data->limit != 0 && data->delivered >= data->limit)
+            break;
+        if (!g_variant_iter_next (&data->iter, "@a{sv}", &identity_var))
+            break;
+
+        if (!identity_filter_match (data->filter, identity_var))
+        {
+            g_variant_unref (identity_var);
+            continue;
+        }
+
+        if (data->position++ < data->offset)
+        {
+            g_variant_unref (identity_var);
+            continue;
+        }
+
+        info = signon_identity_info_new_from_variant (identity_var);
+        g_variant_unref (identity_var);
+
+        (data->cb) (data->service, info, NULL, data->userdata);
+        signon_identity_info_free (info);
+        data->delivered++;
+    }
+
+    if (n == QUERY_IDENTITIES_CHUNK)
+        return TRUE;
+
+    (data->cb) (data->service, NULL, NULL, data->userdata);
+    identity_stream_data_free (data);
+    return FALSE;
+}
+
+static void
+auth_query_identities_stream_cb (GObject *object, GAsyncResult *res,
+                                 gpointer user_data)
+{
+    SsoAuthService *proxy = SSO_AUTH_SERVICE (object);
+    IdentityStreamData *data = (IdentityStreamData *) user_data;
+    GError *error = NULL;
+    GSource *source;
+
+    g_return_if_fail (data != NULL);
+
+    sso_auth_service_call_query_identities_finish (proxy,
+                                                   &data->identities,
+                                                   res,
+                                                   &error);
+    if (error)
+    {
+        (data->cb) (data->service, NULL, error, data->userdata);
+        g_error_free (error);
+        identity_stream_data_free (data);
+        return;
+    }
+
+    g_variant_iter_init (&data->iter, data->identities);
+
+    source = g_idle_source_new ();
+    g_source_set_callback (source, auth_query_identities_stream_idle,
+                           data, NULL);
+    g_source_attach (source, g_main_context_get_thread_default ());
+    g_source_unref (source);
 }
 
+static void
+auth_query_identities_stream_ready_cb (gpointer object, const GError *error,
+                                       gpointer user_data)
+{
+    SignonAuthService *auth_service = SIGNON_AUTH_SERVICE (object);
+    IdentityStreamData *data = (IdentityStreamData *) user_data;
+
+    if (error)
+    {
+        (data->cb) (data->service, NULL, error, data->userdata);
+        identity_stream_data_free (data);
+        return;
+    }
+
+    sso_auth_service_call_query_identities (auth_service->priv->proxy,
+                                            data->filter,
+                                            data->application_context,
+                                            auth_service->priv->cancellable,
+                                            auth_query_identities_stream_cb,
+                                            data);
+    g_free (data->application_context);
+    data->application_context = NULL;
+}
+
+/**
+ * SignonQueryIdentitiesStreamCb:
+ * @auth_service: the #SignonAuthService.
+ * @info: (transfer none) (allow-none): the next #SignonIdentityInfo, or
+ * %NULL when there are no more identities or an error occurred.
+ * @error: a #GError if an error occurred, %NULL otherwise.
+ * @user_data: the user data that was passed when installing this callback.
+ *
+ * Callback to be passed to signon_auth_service_query_identities_stream().
+ * @info is only valid until the callback returns; use
+ * signon_identity_info_copy() to keep it.
+ */
+
+/**
+ * signon_auth_service_query_identities_stream:
+ * @auth_service: the #SignonAuthService.
+ * @filter: (allow-none): filter variant dictionary based on #GHashTable.
+ * @application_context: application security context, can be %NULL.
+ * @offset: the number of matching identities to skip.
+ * @limit: the maximum number of identities to deliver, or 0 for no limit.
+ * @cb: (scope async): callback to be invoked for each identity.
+ * @user_data: user data.
+ *
+ * Query available identities like signon_auth_service_query_identities(),
+ * but deliver them one by one: @cb is invoked once for each identity and a
+ * last time with a %NULL info (and an error, if the query failed). Only one
+ * #SignonIdentityInfo exists at a time, and the identities are delivered
+ * in small batches from the main loop so that very large results don't
+ * stall it.
+ *
+ * @offset and @limit select a window of the result, for instance to
+ * present it page by page.
+ */
+void
+signon_auth_service_query_identities_stream (SignonAuthService *auth_service,
+                                             SignonIdentityFilter *filter,
+                                             const gchar *application_context,
+                                             guint offset,
+                                             guint limit,
+                                             SignonQueryIdentitiesStreamCb cb,
+                                             gpointer user_data)
+{
+    IdentityStreamData *cb_data;
+
+    g_return_if_fail (SIGNON_IS_AUTH_SERVICE (auth_service));
+    g_return_if_fail (cb != NULL);
+
+    cb_data = g_slice_new0 (IdentityStreamData);
+    cb_data->service = g_object_ref (auth_service);
+    cb_data->cb = cb;
+    cb_data->userdata = user_data;
+    cb_data->filter = auth_service_build_filter (filter,
+                                                 SIGNON_IDENTITY_INFO_FIELD_ALL);
+    cb_data->application_context =
+        g_strdup (application_context ? application_context : "");
+    cb_data->offset = offset;
+    cb_data->limit = limit;
+
+    _signon_object_call_when_ready (auth_service,
+                                    &auth_service->priv->ready_state,
+                                    auth_query_identities_stream_ready_cb,
+                                    cb_data);
+}
+
+/**
+ * signon_auth_service_get_identity_change_sequence:
+ * @auth_service: the #SignonAuthService.
+ *
+ * Get the sequence number of the most recent identity change; pass it
+ * later to signon_auth_service_get_identity_changes() to get the changes
+ * which happened since then. Sequence numbers are only meaningful within
+ * the current process.
+ *
+ * Returns: the current sequence number.
+ */
+guint
+signon_auth_service_get_identity_change_sequence (SignonAuthService *auth_service)
+{
+    guint sequence;
+
+    g_return_val_if_fail (SIGNON_IS_AUTH_SERVICE (auth_service), 0);
+
+    g_mutex_lock (&change_mutex);
+    sequence = change_sequence;
+    g_mutex_unlock (&change_mutex);
+
+    return sequence;
+}
+
+/**
+ * signon_auth_service_get_identity_changes:
+ * @auth_service: the #SignonAuthService.
+ * @since: a sequence number.
+ *
+ * Get the identity changes which happened after the one numbered @since,
+ * as also reported by the #SignonAuthService::identity-changed signal.
+ * Only a limited number of changes is remembered, and changes which
+ * happen while the connection to the gSSO daemon is down cannot be seen:
+ * in both cases %NULL is returned, and the identities have to be queried
+ * again.
+ *
+ * Returns: (transfer full) (element-type SignonIdentityChange): the
+ * #SignonIdentityChange entries, oldest first, or %NULL if some of the
+ * changes since @since are not known.
+ */
+GArray *
+signon_auth_service_get_identity_changes (SignonAuthService *auth_service,
+                                          guint since)
+{
+    GArray *changes;
+    guint sequence;
+
+    g_return_val_if_fail (SIGNON_IS_AUTH_SERVICE (auth_service), NULL);
+
+    g_mutex_lock (&change_mutex);
+
+    if ((change_horizon_set && since <= change_horizon) ||
+        change_sequence - since > IDENTITY_CHANGE_LOG_SIZE)
+    {
+        g_mutex_unlock (&change_mutex);
+        return NULL;
+    }
+
+    changes = g_array_new (FALSE, FALSE, sizeof (SignonIdentityChange));
+    for (sequence = since + 1; sequence <= change_sequence; sequence++)
+        g_array_append_val (changes,
+                            change_log[sequence % IDENTITY_CHANGE_LOG_SIZE]);
+
+    g_mutex_unlock (&change_mutex);
+
+    return changes;
+}
 
 static void
 auth_clear_cb (GObject *object, GAsyncResult *res, gpointer user_data)
@@ -422,6 +1823,25 @@ auth_clear_cb (GObject *object, GAsyncResult *res, gpointer user_data)
     g_slice_free (ClearCbData, data);
 }
 
+static void
+auth_clear_ready_cb (gpointer object, const GError *error, gpointer user_data)
+{
+    SignonAuthService *auth_service = SIGNON_AUTH_SERVICE (object);
+    ClearCbData *data = (ClearCbData*)user_data;
+
+    if (error)
+    {
+        (data->cb) (data->service, FALSE, error, data->userdata);
+        g_slice_free (ClearCbData, data);
+        return;
+    }
+
+    sso_auth_service_call_clear (auth_service->priv->proxy,
+                                 auth_service->priv->cancellable,
+                                 auth_clear_cb,
+                                 data);
+}
+
 /**
  * SignonClearCb:
  * @auth_service: the #SignonAuthService.
@@ -445,11 +1865,8 @@ signon_auth_service_clear (SignonAuthService *auth_service,
                            SignonClearCb cb,
                            gpointer user_data)
 {
-    SignonAuthServicePrivate *priv;
-
     g_return_if_fail (SIGNON_IS_AUTH_SERVICE (auth_service));
     g_return_if_fail (cb != NULL);
-    priv = SIGNON_AUTH_SERVICE_PRIV (auth_service);
 
     ClearCbData *cb_data;
     cb_data = g_slice_new (ClearCbData);
@@ -457,9 +1874,9 @@ signon_auth_service_clear (SignonAuthService *auth_service,
     cb_data->cb = cb;
     cb_data->userdata = user_data;
 
-    sso_auth_service_call_clear (priv->proxy,
-                                 priv->cancellable,
-                                 auth_clear_cb,
-                                 cb_data);
+    _signon_object_call_when_ready (auth_service,
+                                    &auth_service->priv->ready_state,
+                                    auth_clear_ready_cb,
+                                    cb_data);
 }
 
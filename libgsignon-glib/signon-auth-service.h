@@ -28,6 +28,9 @@
 #define _SIGNON_AUTH_SERVICE_H_
 
 #include <glib-object.h>
+#include <gio/gio.h>
+#include <libgsignon-glib/signon-identity-info.h>
+#include <libgsignon-glib/signon-security-context.h>
 
 G_BEGIN_DECLS
 
@@ -66,6 +69,36 @@ struct _SignonAuthService
 
 GType signon_auth_service_get_type (void) G_GNUC_CONST;
 
+/**
+ * SignonIdentityChangeType:
+ * @SIGNON_IDENTITY_CHANGE_ADDED: a new identity was stored
+ * @SIGNON_IDENTITY_CHANGE_UPDATED: the data of an identity changed
+ * @SIGNON_IDENTITY_CHANGE_REMOVED: an identity was removed
+ *
+ * The kinds of changes reported by the #SignonAuthService::identity-changed
+ * signal.
+ */
+typedef enum {
+    SIGNON_IDENTITY_CHANGE_ADDED,
+    SIGNON_IDENTITY_CHANGE_UPDATED,
+    SIGNON_IDENTITY_CHANGE_REMOVED
+} SignonIdentityChangeType;
+
+/**
+ * SignonIdentityChange:
+ * @sequence: the sequence number of the change.
+ * @type: the kind of change.
+ * @id: the ID of the identity which changed.
+ *
+ * An entry of the list returned by
+ * signon_auth_service_get_identity_changes().
+ */
+typedef struct {
+    guint sequence;
+    SignonIdentityChangeType type;
+    guint32 id;
+} SignonIdentityChange;
+
 typedef void (*SignonQueryMethodsCb) (SignonAuthService *auth_service,
                                       gchar **methods,
                                       const GError *error,
@@ -92,17 +125,67 @@ typedef GList SignonIdentityList;
 /**
  * SignonIdentityFilter:
  *
- * #GHashTable based filter variant dictionary.
+ * #GHashTable based filter variant dictionary. Use
+ * signon_identity_filter_new() and the signon_identity_filter_set_*()
+ * functions to build it.
  */
 typedef GHashTable SignonIdentityFilter;
 
+SignonIdentityFilter *signon_identity_filter_new (void);
+void signon_identity_filter_free (SignonIdentityFilter *filter);
+
+void signon_identity_filter_set_owner (SignonIdentityFilter *filter,
+                                       const SignonSecurityContext *owner);
+void signon_identity_filter_set_type (SignonIdentityFilter *filter,
+                                      SignonIdentityType type);
+void signon_identity_filter_set_caption (SignonIdentityFilter *filter,
+                                         const gchar *caption_prefix);
+void signon_identity_filter_set_id_range (SignonIdentityFilter *filter,
+                                          guint32 min_id,
+                                          guint32 max_id);
+void signon_identity_filter_set_method (SignonIdentityFilter *filter,
+                                        const gchar *method);
+void signon_identity_filter_set_realm (SignonIdentityFilter *filter,
+                                       const gchar *realm);
+void signon_identity_filter_set_acl_member (SignonIdentityFilter *filter,
+                                            const SignonSecurityContext *context);
+void signon_identity_filter_set_type_mask (SignonIdentityFilter *filter,
+                                           guint types);
+
 typedef void (*SignonQueryIdentitiesCb) (SignonAuthService *auth_service,
                                          SignonIdentityList *identities,
                                          const GError *error,
                                          gpointer user_data);
 
+typedef void (*SignonQueryIdentitiesStreamCb) (SignonAuthService *auth_service,
+                                               SignonIdentityInfo *info,
+                                               const GError *error,
+                                               gpointer user_data);
+
 SignonAuthService *signon_auth_service_new ();
 
+void signon_auth_service_new_async (GCancellable *cancellable,
+                                    GAsyncReadyCallback callback,
+                                    gpointer user_data);
+
+SignonAuthService *signon_auth_service_new_finish (GAsyncResult *res,
+                                                   GError **error);
+
+void signon_auth_service_prewarm (const guint32 *ids, guint n_ids,
+                                  const gchar *application_context);
+
+void signon_auth_service_get_identities_async (SignonAuthService *auth_service,
+                                               const guint32 *ids,
+                                               guint n_ids,
+                                               const gchar *application_context,
+                                               GCancellable *cancellable,
+                                               GAsyncReadyCallback callback,
+                                               gpointer user_data);
+
+GPtrArray *signon_auth_service_get_identities_finish (SignonAuthService *auth_service,
+                                                      GAsyncResult *res,
+                                                      GError **error);
+
 void signon_auth_service_query_methods (SignonAuthService *auth_service,
                                         SignonQueryMethodsCb cb,
                                         gpointer user_data);
@@ -112,12 +195,37 @@ void signon_auth_service_query_mechanisms (SignonAuthService *auth_service,
                                            SignonQueryMechanismCb cb,
                                            gpointer user_data);
 
+gchar **signon_auth_service_get_cached_methods (SignonAuthService *auth_service);
+
+gchar **signon_auth_service_get_cached_mechanisms (SignonAuthService *auth_service,
+                                                   const gchar *method);
+
 void signon_auth_service_query_identities (SignonAuthService *auth_service,
                                            SignonIdentityFilter *filter,
                                            const gchar *application_context,
                                            SignonQueryIdentitiesCb cb,
                                            gpointer user_data);
 
+void signon_auth_service_query_identities_with_fields (SignonAuthService *auth_service,
+                                                       SignonIdentityFilter *filter,
+                                                       const gchar *application_context,
+                                                       SignonIdentityInfoField fields,
+                                                       SignonQueryIdentitiesCb cb,
+                                                       gpointer user_data);
+
+void signon_auth_service_query_identities_stream (SignonAuthService *auth_service,
+                                                  SignonIdentityFilter *filter,
+                                                  const gchar *application_context,
+                                                  guint offset,
+                                                  guint limit,
+                                                  SignonQueryIdentitiesStreamCb cb,
+                                                  gpointer user_data);
+
+guint signon_auth_service_get_identity_change_sequence (SignonAuthService *auth_service);
+
+GArray *signon_auth_service_get_identity_changes (SignonAuthService *auth_service,
+                                                  guint since);
+
 void signon_auth_service_clear (SignonAuthService *auth_service,
                                 SignonClearCb cb,
                                 gpointer user_data);
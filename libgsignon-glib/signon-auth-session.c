@@ -71,6 +71,7 @@ static const gchar data_key_process[] = "signon-process";
 struct _SignonAuthSessionPrivate
 {
     SsoAuthSession *proxy;
+    SsoSignalWatch *signal_watch;
     SignonIdentity *identity;
     GCancellable *cancellable;
 
@@ -82,8 +83,19 @@ struct _SignonAuthSessionPrivate
     gboolean canceled;
     gboolean dispose_has_run;
 
-    guint signal_state_changed;
-    guint signal_unregistered;
+    SsoDisconnectHook *disconnect_hook;
+
+    SignonReadyState ready_state;
+
+    /* process requests not yet sent, sorted by priority */
+    GQueue pending;
+    guint in_flight;
+    guint max_in_flight;
+    guint max_pending;
+    GSource *dispatch_source;
+
+    guint result_cache_lifetime;
+    gboolean share_requests;
 };
 
 typedef struct _AuthSessionQueryAvailableMechanismsData
@@ -97,6 +109,12 @@ typedef struct _AuthSessionProcessData
     GVariant *session_data;
     gchar *mechanism;
     GCancellable *cancellable;
+    GMainContext *context;
+    gulong cancel_id;
+    gint priority;
+    gboolean queued;
+    guint results_serial;
+    gchar *shared_key;
 } AuthSessionProcessData;
 
 typedef struct _AuthSessionQueryAvailableMechanismsCbData
@@ -104,6 +122,9 @@ typedef struct _AuthSessionQueryAvailableMechanismsCbData
     SignonAuthSession *self;
     SignonAuthSessionQueryAvailableMechanismsCb cb;
     gpointer user_data;
+    gchar **wanted_mechanisms;
+    guint serial;
+    gchar **cached;
 } AuthSessionQueryAvailableMechanismsCbData;
 
 typedef struct _AuthSessionProcessCbData
@@ -112,12 +133,27 @@ typedef struct _AuthSessionProcessCbData
     gpointer user_data;
 } AuthSessionProcessCbData;
 
+typedef struct _AuthSessionBatchData
+{
+    GSimpleAsyncResult *res;
+    SignonAuthSessionBatchItemCb item_cb;
+    gpointer item_data;
+    guint remaining;
+} AuthSessionBatchData;
+
+typedef struct _AuthSessionBatchItemData
+{
+    AuthSessionBatchData *batch;
+    guint index;
+} AuthSessionBatchItemData;
+
 #define SIGNON_AUTH_SESSION_PRIV(obj) (SIGNON_AUTH_SESSION(obj)->priv)
 #define SIGNON_AUTH_SESSION_GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SIGNON_TYPE_AUTH_SESSION, SignonAuthSessionPrivate))
 
 
 static void auth_session_state_changed_cb (GDBusProxy *proxy, gint state, gchar *message, gpointer user_data);
 static void auth_session_remote_object_destroyed_cb (GDBusProxy *proxy, gpointer user_data);
+static void auth_session_disconnected (gpointer user_data);
 
 static gboolean auth_session_priv_init (SignonAuthSession *self, const gchar *method_name, GError **err);
 
@@ -125,15 +161,240 @@ static void auth_session_query_available_mechanisms_ready_cb (gpointer object, c
 static void auth_session_cancel_ready_cb (gpointer object, const GError *error, gpointer user_data);
 
 static void auth_session_check_remote_object(SignonAuthSession *self);
+static void auth_session_process_ready_cb (gpointer object, const GError *error, gpointer user_data);
+static void auth_session_process_enqueue (SignonAuthSession *self, GSimpleAsyncResult *res);
 
 static void
 auth_session_process_data_free (AuthSessionProcessData *process_data)
 {
     g_free (process_data->mechanism);
+    g_free (process_data->shared_key);
     g_variant_unref (process_data->session_data);
+    if (process_data->cancellable)
+        g_object_unref (process_data->cancellable);
+    if (process_data->context)
+        g_main_context_unref (process_data->context);
     g_slice_free (AuthSessionProcessData, process_data);
 }
 
+static gboolean
+auth_session_wants_new_token (GVariant *session_data)
+{
+    gboolean renew = FALSE;
+
+    g_variant_lookup (session_data, SIGNON_SESSION_DATA_RENEW_TOKEN,
+                      "b", &renew);
+    return renew;
+}
+
+static void
+auth_session_process_share (SignonAuthSession *self,
+                            GSimpleAsyncResult *res,
+                            GVariant *reply,
+                            const GError *error)
+{
+    AuthSessionProcessData *process_data =
+        g_object_get_data ((GObject *)res, data_key_process);
+
+    if (process_data->shared_key == NULL)
+        return;
+
+    /* A cancellation of this session is not passed on to the waiters of
+     * other sessions: one of them sends the request again */
+    if (error != NULL &&
+        error->domain == signon_error_quark () &&
+        error->code == SIGNON_ERROR_SESSION_CANCELED)
+    {
+        GSimpleAsyncResult *leader;
+
+        leader = _signon_identity_hand_over_request (self->priv->identity,
+                                                     process_data->shared_key,
+                                                     self, error);
+        if (leader != NULL)
+        {
+            SignonAuthSession *session;
+            AuthSessionProcessData *leader_data;
+
+            DEBUG ("%s: handing the request over", G_STRFUNC);
+            session = SIGNON_AUTH_SESSION (g_async_result_get_source_object (
+                (GAsyncResult *)leader));
+            leader_data = g_object_get_data ((GObject *)leader,
+                                             data_key_process);
+            leader_data->shared_key = process_data->shared_key;
+            process_data->shared_key = NULL;
+
+            auth_session_process_enqueue (session, leader);
+            g_object_unref (session);
+            return;
+        }
+    }
+    else
+        _signon_identity_release_request (self->priv->identity,
+                                          process_data->shared_key,
+                                          reply, error);
+
+    g_free (process_data->shared_key);
+    process_data->shared_key = NULL;
+}
+
+static gint
+auth_session_process_compare (gconstpointer a, gconstpointer b,
+                              gpointer user_data)
+{
+    AuthSessionProcessData *queued =
+        g_object_get_data ((GObject *)a, data_key_process);
+    AuthSessionProcessData *incoming =
+        g_object_get_data ((GObject *)b, data_key_process);
+
+    /* requests of the same priority are kept in FIFO order */
+    return queued->priority <= incoming->priority ? -1 : 1;
+}
+
+static void
+auth_session_process_unqueue (SignonAuthSession *self,
+                              GSimpleAsyncResult *res)
+{
+    SignonAuthSessionPrivate *priv = self->priv;
+    AuthSessionProcessData *process_data =
+        g_object_get_data ((GObject *)res, data_key_process);
+
+    if (process_data->queued)
+    {
+        g_queue_remove (&priv->pending, res);
+        process_data->queued = FALSE;
+    }
+
+    if (process_data->cancel_id != 0)
+    {
+        g_cancellable_disconnect (process_data->cancellable,
+                                  process_data->cancel_id);
+        process_data->cancel_id = 0;
+    }
+}
+
+static void
+auth_session_process_dispatch (SignonAuthSession *self)
+{
+    SignonAuthSessionPrivate *priv = self->priv;
+
+    while (!g_queue_is_empty (&priv->pending) &&
+           (priv->max_in_flight == 0 ||
+            priv->in_flight < priv->max_in_flight))
+    {
+        GSimpleAsyncResult *res = g_queue_peek_head (&priv->pending);
+
+        auth_session_process_unqueue (self, res);
+        priv->in_flight++;
+
+        auth_session_check_remote_object(self);
+        _signon_object_call_when_ready (self,
+                                        &priv->ready_state,
+                                        auth_session_process_ready_cb,
+                                        res);
+    }
+}
+
+static void
+auth_session_process_enqueue (SignonAuthSession *self,
+                              GSimpleAsyncResult *res)
+{
+    SignonAuthSessionPrivate *priv = self->priv;
+    AuthSessionProcessData *process_data =
+        g_object_get_data ((GObject *)res, data_key_process);
+
+    process_data->queued = TRUE;
+    g_queue_insert_sorted (&priv->pending, res,
+                           auth_session_process_compare, NULL);
+    priv->busy = TRUE;
+
+    auth_session_process_dispatch (self);
+}
+
+static gboolean
+auth_session_process_dispatch_idle (gpointer user_data)
+{
+    SignonAuthSession *self = SIGNON_AUTH_SESSION (user_data);
+
+    g_source_unref (self->priv->dispatch_source);
+    self->priv->dispatch_source = NULL;
+    auth_session_process_dispatch (self);
+    return FALSE;
+}
+
+static void
+auth_session_process_done (SignonAuthSession *self)
+{
+    SignonAuthSessionPrivate *priv = self->priv;
+
+    g_return_if_fail (priv->in_flight > 0);
+
+    priv->in_flight--;
+    priv->busy = priv->in_flight > 0 || !g_queue_is_empty (&priv->pending);
+
+    /* The next request is sent from an idle, so that a session failing
+     * every request does not recurse through the whole queue */
+    if (!g_queue_is_empty (&priv->pending) && priv->dispatch_source == NULL)
+    {
+        priv->dispatch_source = g_idle_source_new ();
+        g_source_set_callback (priv->dispatch_source,
+                               auth_session_process_dispatch_idle,
+                               self, NULL);
+        g_source_attach (priv->dispatch_source,
+                         g_main_context_get_thread_default ());
+    }
+}
+
+static gboolean
+auth_session_process_cancelled_idle (gpointer user_data)
+{
+    GSimpleAsyncResult *res = user_data;
+    AuthSessionProcessData *process_data;
+    SignonAuthSession *self;
+    GError *error = NULL;
+
+    process_data = g_object_get_data ((GObject *)res, data_key_process);
+
+    /* Requests already sent to the daemon are cancelled with their D-Bus
+     * call */
+    if (!process_data->queued)
+        return FALSE;
+
+    self = SIGNON_AUTH_SESSION (g_async_result_get_source_object (
+        (GAsyncResult *)res));
+    DEBUG ("%s: dropping cancelled request", G_STRFUNC);
+
+    auth_session_process_unqueue (self, res);
+    self->priv->busy = self->priv->in_flight > 0 ||
+        !g_queue_is_empty (&self->priv->pending);
+
+    g_cancellable_set_error_if_cancelled (process_data->cancellable, &error);
+    auth_session_process_share (self, res, NULL, error);
+    g_simple_async_result_take_error (res, error);
+    g_simple_async_result_complete (res);
+    g_object_unref (res);
+    g_object_unref (self);
+    return FALSE;
+}
+
+static void
+auth_session_process_cancelled_cb (GCancellable *cancellable,
+                                   gpointer user_data)
+{
+    GSimpleAsyncResult *res = user_data;
+    AuthSessionProcessData *process_data;
+    GSource *source;
+
+    /* This can be called from any thread, and the handler cannot be
+     * disconnected from within itself: drop the request from the context
+     * where it was made */
+    process_data = g_object_get_data ((GObject *)res, data_key_process);
+    source = g_idle_source_new ();
+    g_source_set_callback (source, auth_session_process_cancelled_idle,
+                           g_object_ref (res), g_object_unref);
+    g_source_attach (source, process_data->context);
+    g_source_unref (source);
+}
+
 static void
 auth_session_process_reply (GObject *object, GAsyncResult *res,
                             gpointer userdata)
@@ -151,16 +412,31 @@ auth_session_process_reply (GObject *object, GAsyncResult *res,
 
     self = SIGNON_AUTH_SESSION (g_async_result_get_source_object (
         (GAsyncResult *)res_process));
-    self->priv->busy = FALSE;
 
     if (G_LIKELY (error == NULL))
     {
+        if (self->priv->result_cache_lifetime != 0)
+        {
+            AuthSessionProcessData *process_data =
+                g_object_get_data ((GObject *)res_process, data_key_process);
+
+            _signon_identity_store_result (self->priv->identity,
+                                           process_data->results_serial,
+                                           self->priv->method_name,
+                                           process_data->mechanism,
+                                           process_data->session_data,
+                                           reply,
+                                           self->priv->result_cache_lifetime);
+        }
+
+        auth_session_process_share (self, res_process, reply, NULL);
         g_simple_async_result_set_op_res_gpointer (res_process, reply,
                                                    (GDestroyNotify)
                                                    g_variant_unref);
     }
     else
     {
+        auth_session_process_share (self, res_process, NULL, error);
         g_simple_async_result_take_error (res_process, error);
     }
 
@@ -170,6 +446,7 @@ auth_session_process_reply (GObject *object, GAsyncResult *res,
      */
     g_simple_async_result_complete_in_idle (res_process);
     g_object_unref (res_process);
+    auth_session_process_done (self);
     g_object_unref (self);
 }
 
@@ -187,22 +464,27 @@ auth_session_process_ready_cb (gpointer object, const GError *error, gpointer us
     if (error != NULL)
     {
         DEBUG ("AuthSessionError: %s", error->message);
+        auth_session_process_share (self, res, NULL, error);
         g_simple_async_result_set_from_error (res, error);
-        g_simple_async_result_complete (res);
+        g_simple_async_result_complete_in_idle (res);
         g_object_unref (res);
+        auth_session_process_done (self);
         return;
     }
 
     if (priv->canceled)
     {
-        priv->busy = FALSE;
+        GError *cancel_error;
+
         priv->canceled = FALSE;
-        g_simple_async_result_set_error (res,
-                                         signon_error_quark (),
-                                         SIGNON_ERROR_SESSION_CANCELED,
-                                         "Authentication session was canceled");
-        g_simple_async_result_complete (res);
+        cancel_error = g_error_new (signon_error_quark (),
+                                    SIGNON_ERROR_SESSION_CANCELED,
+                                    "Authentication session was canceled");
+        auth_session_process_share (self, res, NULL, cancel_error);
+        g_simple_async_result_take_error (res, cancel_error);
+        g_simple_async_result_complete_in_idle (res);
         g_object_unref (res);
+        auth_session_process_done (self);
         return;
     }
 
@@ -252,17 +534,6 @@ process_async_cb_wrapper (GObject *object, GAsyncResult *res,
     g_clear_error (&error);
 }
 
-static GQuark
-auth_session_object_quark ()
-{
-  static GQuark quark = 0;
-
-  if (!quark)
-    quark = g_quark_from_static_string ("auth_session_object_quark");
-
-  return quark;
-}
-
 static void
 signon_auth_session_set_property (GObject *object,
                                   guint property_id,
@@ -303,7 +574,11 @@ static void
 signon_auth_session_init (SignonAuthSession *self)
 {
     self->priv = SIGNON_AUTH_SESSION_GET_PRIV (self);
+    _signon_ready_state_init (&self->priv->ready_state);
     self->priv->cancellable = g_cancellable_new ();
+    g_queue_init (&self->priv->pending);
+    self->priv->disconnect_hook =
+        sso_auth_service_add_disconnect_hook (auth_session_disconnected, self);
 }
 
 static void
@@ -317,6 +592,19 @@ signon_auth_session_dispose (GObject *object)
     if (priv->dispose_has_run)
         return;
 
+    if (priv->disconnect_hook)
+    {
+        sso_auth_service_remove_disconnect_hook (priv->disconnect_hook);
+        priv->disconnect_hook = NULL;
+    }
+
+    if (priv->dispatch_source)
+    {
+        g_source_destroy (priv->dispatch_source);
+        g_source_unref (priv->dispatch_source);
+        priv->dispatch_source = NULL;
+    }
+
     if (priv->cancellable)
     {
         g_cancellable_cancel (priv->cancellable);
@@ -326,8 +614,8 @@ signon_auth_session_dispose (GObject *object)
 
     if (priv->proxy)
     {
-        g_signal_handler_disconnect (priv->proxy, priv->signal_state_changed);
-        g_signal_handler_disconnect (priv->proxy, priv->signal_unregistered);
+        sso_auth_service_unwatch_object (priv->signal_watch);
+        priv->signal_watch = NULL;
         g_object_unref (priv->proxy);
 
         priv->proxy = NULL;
@@ -347,6 +635,8 @@ signon_auth_session_finalize (GObject *object)
     SignonAuthSessionPrivate *priv = self->priv;
     g_return_if_fail (priv != NULL);
 
+    _signon_ready_state_clear (&priv->ready_state, object);
+
     g_free (priv->method_name);
     g_object_unref (priv->identity);
 
@@ -468,6 +758,12 @@ signon_auth_session_new_for_identity (SignonIdentity *identity,
         return NULL;
     }
 
+    /* Request the remote object right away: the request is queued behind
+     * the registration of the identity and goes out as soon as that
+     * completes, instead of waiting for the first operation on the session
+     */
+    auth_session_check_remote_object (self);
+
     return self;
 }
 
@@ -500,6 +796,18 @@ signon_auth_session_get_method (SignonAuthSession *self)
  * Callback to be passed to signon_auth_session_query_available_mechanisms().
  */
 
+static gboolean
+auth_session_query_mechanisms_cached_cb (gpointer user_data)
+{
+    AuthSessionQueryAvailableMechanismsCbData *cb_data = user_data;
+
+    (cb_data->cb) (cb_data->self, cb_data->cached, NULL, cb_data->user_data);
+
+    g_object_unref (cb_data->self);
+    g_slice_free (AuthSessionQueryAvailableMechanismsCbData, cb_data);
+    return FALSE;
+}
+
 /**
  * signon_auth_session_query_available_mechanisms:
  * @self: the #SignonAuthSession.
@@ -528,13 +836,32 @@ signon_auth_session_query_available_mechanisms (SignonAuthSession *self,
     cb_data->cb = cb;
     cb_data->user_data = user_data;
 
+    cb_data->cached =
+        _signon_identity_lookup_mechanisms (priv->identity,
+                                            priv->method_name,
+                                            wanted_mechanisms);
+    if (cb_data->cached != NULL)
+    {
+        GSource *source;
+
+        DEBUG ("%s: known answer", G_STRFUNC);
+        g_object_ref (self);
+        source = g_idle_source_new ();
+        g_source_set_callback (source,
+                               auth_session_query_mechanisms_cached_cb,
+                               cb_data, NULL);
+        g_source_attach (source, g_main_context_get_thread_default ());
+        g_source_unref (source);
+        return;
+    }
+
     AuthSessionQueryAvailableMechanismsData *operation_data = g_slice_new0 (AuthSessionQueryAvailableMechanismsData);
     operation_data->wanted_mechanisms = g_strdupv ((gchar **)wanted_mechanisms);
     operation_data->cb_data = cb_data;
 
     auth_session_check_remote_object(self);
     _signon_object_call_when_ready (self,
-                                    auth_session_object_quark(),
+                                    &self->priv->ready_state,
                                     auth_session_query_available_mechanisms_ready_cb,
                                     operation_data);
 }
@@ -614,6 +941,9 @@ signon_auth_session_process (SignonAuthSession *self,
  * @session_data. The daemon also passes a list of identity's allowed realms to the plugin,
  * and they cannot be overriden.
  *
+ * The request is queued with the default priority; see
+ * signon_auth_session_process_full().
+ *
  * Since: 1.8
  */
 void
@@ -623,6 +953,50 @@ signon_auth_session_process_async (SignonAuthSession *self,
                                    GCancellable *cancellable,
                                    GAsyncReadyCallback callback,
                                    gpointer user_data)
+{
+    signon_auth_session_process_full (self, session_data, mechanism,
+                                      G_PRIORITY_DEFAULT, cancellable,
+                                      callback, user_data);
+}
+
+/**
+ * signon_auth_session_process_full:
+ * @self: the #SignonAuthSession.
+ * @session_data: (transfer full): a dictionary of parameters.
+ * @mechanism: the authentication mechanism to be used.
+ * @priority: the priority of the request; lower values are sent first, as
+ * with %G_PRIORITY_DEFAULT.
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @callback: (scope async): a callback which will be called when the
+ * authentication reply is available.
+ * @user_data: user data to be passed to the callback.
+ *
+ * Same as signon_auth_session_process_async(), with a priority for the
+ * request. Requests are held in a queue on the client side until the
+ * session has fewer requests outstanding in the daemon than allowed by
+ * signon_auth_session_set_queue_limits(); requests of the same priority are
+ * sent in the order they were made. Cancelling @cancellable while the
+ * request is still queued removes it from the queue without contacting the
+ * daemon.
+ *
+ * If the queue is full the request fails with
+ * %SIGNON_ERROR_SERVICE_NOT_AVAILABLE. Use
+ * signon_auth_session_process_finish() to collect the result.
+ *
+ * If the result cache is enabled with
+ * signon_auth_session_set_result_cache_lifetime(), a reply to an identical
+ * request which is still valid is returned without contacting the daemon.
+ * If request sharing is enabled with signon_auth_session_set_share_requests(),
+ * a request identical to one in flight waits for the reply of that one.
+ */
+void
+signon_auth_session_process_full (SignonAuthSession *self,
+                                  GVariant *session_data,
+                                  const gchar *mechanism,
+                                  gint priority,
+                                  GCancellable *cancellable,
+                                  GAsyncReadyCallback callback,
+                                  gpointer user_data)
 {
     SignonAuthSessionPrivate *priv;
     AuthSessionProcessData *process_data;
@@ -636,21 +1010,321 @@ signon_auth_session_process_async (SignonAuthSession *self,
     res = g_simple_async_result_new ((GObject *)self, callback, user_data,
                                      signon_auth_session_process_async);
     g_simple_async_result_set_check_cancellable (res, cancellable);
+    g_variant_ref_sink (session_data);
+
+    if (priv->result_cache_lifetime != 0 &&
+        !auth_session_wants_new_token (session_data))
+    {
+        GVariant *reply;
+
+        reply = _signon_identity_lookup_result (priv->identity,
+                                                priv->method_name,
+                                                mechanism,
+                                                session_data);
+        if (reply != NULL)
+        {
+            DEBUG ("%s: reply found in cache", G_STRFUNC);
+            g_variant_unref (session_data);
+            g_simple_async_result_set_op_res_gpointer (res, reply,
+                                                       (GDestroyNotify)
+                                                       g_variant_unref);
+            g_simple_async_result_complete_in_idle (res);
+            g_object_unref (res);
+            return;
+        }
+    }
 
     process_data = g_slice_new0 (AuthSessionProcessData);
-    process_data->session_data = g_variant_ref_sink (session_data);
+    process_data->session_data = session_data;
     process_data->mechanism = g_strdup (mechanism);
-    process_data->cancellable = cancellable;
+    process_data->priority = priority;
+    process_data->results_serial =
+        _signon_identity_get_results_serial (priv->identity);
     g_object_set_data_full ((GObject *)res, data_key_process, process_data,
                             (GDestroyNotify)auth_session_process_data_free);
 
-    priv->busy = TRUE;
+    /* Only requests which cannot be cancelled on their own are shared, so
+     * that the waiters get the reply they asked for */
+    if (priv->share_requests && cancellable == NULL &&
+        !auth_session_wants_new_token (session_data) &&
+        _signon_identity_join_request (priv->identity,
+                                       priv->method_name,
+                                       mechanism,
+                                       session_data,
+                                       res,
+                                       &process_data->shared_key))
+    {
+        g_object_unref (res);
+        return;
+    }
 
-    auth_session_check_remote_object(self);
-    _signon_object_call_when_ready (self,
-                                    auth_session_object_quark(),
-                                    auth_session_process_ready_cb,
-                                    res);
+    if (priv->max_pending != 0 &&
+        g_queue_get_length (&priv->pending) >= priv->max_pending)
+    {
+        GError *error;
+
+        DEBUG ("%s: too many queued requests", G_STRFUNC);
+        error = g_error_new (signon_error_quark (),
+                             SIGNON_ERROR_SERVICE_NOT_AVAILABLE,
+                             "Too many requests queued on the "
+                             "authentication session");
+        auth_session_process_share (self, res, NULL, error);
+        g_simple_async_result_take_error (res, error);
+        g_simple_async_result_complete_in_idle (res);
+        g_object_unref (res);
+        return;
+    }
+
+    if (cancellable != NULL)
+    {
+        process_data->cancellable = g_object_ref (cancellable);
+        process_data->context = g_main_context_ref_thread_default ();
+        process_data->cancel_id =
+            g_cancellable_connect (cancellable,
+                                   G_CALLBACK (auth_session_process_cancelled_cb),
+                                   res, NULL);
+    }
+
+    auth_session_process_enqueue (self, res);
+}
+
+static void
+auth_session_batch_item_cb (GObject *object, GAsyncResult *res,
+                            gpointer user_data)
+{
+    SignonAuthSession *self = SIGNON_AUTH_SESSION (object);
+    AuthSessionBatchItemData *item = user_data;
+    AuthSessionBatchData *batch = item->batch;
+    GVariant *reply;
+    GError *error = NULL;
+
+    reply = signon_auth_session_process_finish (self, res, &error);
+    if (batch->item_cb != NULL)
+        batch->item_cb (self, item->index, reply, error, batch->item_data);
+
+    if (reply != NULL)
+        g_variant_unref (reply);
+    g_clear_error (&error);
+    g_slice_free (AuthSessionBatchItemData, item);
+
+    if (--batch->remaining == 0)
+    {
+        g_simple_async_result_complete_in_idle (batch->res);
+        g_object_unref (batch->res);
+        g_slice_free (AuthSessionBatchData, batch);
+    }
+}
+
+/**
+ * SignonAuthSessionBatchItemCb:
+ * @self: the #SignonAuthSession.
+ * @index: the position of the request in the batch.
+ * @reply: (transfer none) (allow-none): the authentication reply, or %NULL
+ * if an error occurred.
+ * @error: a #GError if an error occurred, %NULL otherwise.
+ * @user_data: the user data that was passed to
+ * signon_auth_session_process_batch_async().
+ *
+ * This callback is invoked for each request of a batch as soon as its
+ * result is available.
+ */
+
+/**
+ * signon_auth_session_process_batch_async:
+ * @self: the #SignonAuthSession.
+ * @requests: (transfer full): a #GVariant of type a(sa{sv}) holding the
+ * mechanism and the session data of each request.
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @item_cb: (allow-none): a callback which will be called
+ * with the result of each request.
+ * @item_data: user data to be passed to @item_cb.
+ * @callback: (scope async): a callback which will be called when all the
+ * requests have completed.
+ * @user_data: user data to be passed to @callback.
+ *
+ * Performs one authentication step for each of @requests, as if
+ * signon_auth_session_process_async() had been called for them in order.
+ * The requests are all handed to the session's queue at once and sent to
+ * the daemon back to back, without waiting for the previous replies; the
+ * results are delivered to @item_cb in the order they arrive. @item_cb is
+ * not called after @callback.
+ */
+void
+signon_auth_session_process_batch_async (SignonAuthSession *self,
+                                         GVariant *requests,
+                                         GCancellable *cancellable,
+                                         SignonAuthSessionBatchItemCb item_cb,
+                                         gpointer item_data,
+                                         GAsyncReadyCallback callback,
+                                         gpointer user_data)
+{
+    AuthSessionBatchData *batch;
+    GVariantIter iter;
+    GVariant *session_data;
+    gchar *mechanism;
+    guint index = 0;
+
+    g_return_if_fail (SIGNON_IS_AUTH_SESSION (self));
+    g_return_if_fail (requests != NULL);
+    g_return_if_fail (g_variant_is_of_type (requests,
+                                            G_VARIANT_TYPE ("a(sa{sv})")));
+
+    g_variant_ref_sink (requests);
+
+    batch = g_slice_new0 (AuthSessionBatchData);
+    batch->res = g_simple_async_result_new ((GObject *)self,
+                                            callback, user_data,
+                                            signon_auth_session_process_batch_async);
+    g_simple_async_result_set_check_cancellable (batch->res, cancellable);
+    batch->item_cb = item_cb;
+    batch->item_data = item_data;
+    batch->remaining = g_variant_n_children (requests);
+
+    if (batch->remaining == 0)
+    {
+        g_simple_async_result_complete_in_idle (batch->res);
+        g_object_unref (batch->res);
+        g_slice_free (AuthSessionBatchData, batch);
+        g_variant_unref (requests);
+        return;
+    }
+
+    /* The batch data can be freed as soon as the last request is handed
+     * over, if that fails immediately: do not touch it in the loop */
+    g_variant_iter_init (&iter, requests);
+    while (g_variant_iter_next (&iter, "(s@a{sv})", &mechanism, &session_data))
+    {
+        AuthSessionBatchItemData *item = g_slice_new (AuthSessionBatchItemData);
+        item->batch = batch;
+        item->index = index++;
+
+        signon_auth_session_process_full (self, session_data, mechanism,
+                                          G_PRIORITY_DEFAULT, cancellable,
+                                          auth_session_batch_item_cb, item);
+        g_variant_unref (session_data);
+        g_free (mechanism);
+    }
+
+    g_variant_unref (requests);
+}
+
+/**
+ * signon_auth_session_process_batch_finish:
+ * @self: the #SignonAuthSession.
+ * @res: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to
+ * signon_auth_session_process_batch_async().
+ * @error: return location for error, or %NULL.
+ *
+ * Collect the result of the signon_auth_session_process_batch_async()
+ * operation. The results of the single requests are delivered to the
+ * #SignonAuthSessionBatchItemCb.
+ *
+ * Returns: %TRUE if all the requests have been processed, %FALSE if the
+ * batch was cancelled.
+ */
+gboolean
+signon_auth_session_process_batch_finish (SignonAuthSession *self,
+                                          GAsyncResult *res,
+                                          GError **error)
+{
+    g_return_val_if_fail (SIGNON_IS_AUTH_SESSION (self), FALSE);
+
+    return !g_simple_async_result_propagate_error ((GSimpleAsyncResult *)res,
+                                                   error);
+}
+
+/**
+ * signon_auth_session_set_queue_limits:
+ * @self: the #SignonAuthSession.
+ * @max_in_flight: the maximum number of requests sent to the daemon and not
+ * yet answered, or 0 for no limit.
+ * @max_pending: the maximum number of requests waiting in the client-side
+ * queue, or 0 for no limit.
+ *
+ * Sets the limits of the request queue of this session. By default neither
+ * is limited, and every request is sent to the daemon immediately, which
+ * queues it after those being processed.
+ */
+void
+signon_auth_session_set_queue_limits (SignonAuthSession *self,
+                                      guint max_in_flight,
+                                      guint max_pending)
+{
+    g_return_if_fail (SIGNON_IS_AUTH_SESSION (self));
+
+    self->priv->max_in_flight = max_in_flight;
+    self->priv->max_pending = max_pending;
+
+    auth_session_process_dispatch (self);
+}
+
+/**
+ * signon_auth_session_set_result_cache_lifetime:
+ * @self: the #SignonAuthSession.
+ * @max_lifetime: the longest time, in seconds, a reply is kept for, or 0
+ * to disable the cache.
+ *
+ * Enables caching of the replies to the process requests made on this
+ * session. The cache is shared by the sessions of the same #SignonIdentity
+ * and is keyed by method, mechanism and session data; the identity must
+ * have been stored. A reply is kept for the number of seconds given in its
+ * "ExpiresIn" field, if any, but not longer than @max_lifetime, and is
+ * dropped when the identity is updated, removed or signed out. Requests
+ * with %SIGNON_SESSION_DATA_RENEW_TOKEN set always go to the daemon.
+ *
+ * The cache is disabled by default.
+ */
+void
+signon_auth_session_set_result_cache_lifetime (SignonAuthSession *self,
+                                               guint max_lifetime)
+{
+    g_return_if_fail (SIGNON_IS_AUTH_SESSION (self));
+
+    self->priv->result_cache_lifetime = max_lifetime;
+}
+
+/**
+ * signon_auth_session_set_share_requests:
+ * @self: the #SignonAuthSession.
+ * @share: whether identical requests should be shared.
+ *
+ * Enables sharing of the process requests made on this session with the
+ * identical requests in flight on the sessions of the same
+ * #SignonIdentity which also share them. A request is identical to
+ * another if it has the same method, mechanism and session data; rather
+ * than being sent to the daemon, it completes with the reply of the
+ * request in flight, or with its error. If the session owning the request
+ * in flight is cancelled with signon_auth_session_cancel(), the request is
+ * sent again on behalf of the waiters of the other sessions. Requests made
+ * with a #GCancellable or with %SIGNON_SESSION_DATA_RENEW_TOKEN set are
+ * never shared.
+ *
+ * Sharing is disabled by default.
+ */
+void
+signon_auth_session_set_share_requests (SignonAuthSession *self,
+                                        gboolean share)
+{
+    g_return_if_fail (SIGNON_IS_AUTH_SESSION (self));
+
+    self->priv->share_requests = share;
+}
+
+/**
+ * signon_auth_session_get_pending_requests:
+ * @self: the #SignonAuthSession.
+ *
+ * Get the number of process requests which are waiting in the client-side
+ * queue and have not been sent to the daemon yet.
+ *
+ * Returns: the number of queued requests.
+ */
+guint
+signon_auth_session_get_pending_requests (SignonAuthSession *self)
+{
+    g_return_val_if_fail (SIGNON_IS_AUTH_SESSION (self), 0);
+
+    return g_queue_get_length (&self->priv->pending);
 }
 
 /**
@@ -702,6 +1376,23 @@ signon_auth_session_cancel (SignonAuthSession *self)
 
     g_return_if_fail (priv != NULL);
 
+    /* Requests still in the queue never reach the daemon */
+    while (!g_queue_is_empty (&priv->pending))
+    {
+        GSimpleAsyncResult *res = g_queue_peek_head (&priv->pending);
+        GError *error;
+
+        auth_session_process_unqueue (self, res);
+        error = g_error_new (signon_error_quark (),
+                             SIGNON_ERROR_SESSION_CANCELED,
+                             "Authentication session was canceled");
+        auth_session_process_share (self, res, NULL, error);
+        g_simple_async_result_take_error (res, error);
+        g_simple_async_result_complete_in_idle (res);
+        g_object_unref (res);
+    }
+    priv->busy = priv->in_flight > 0;
+
     auth_session_check_remote_object(self);
 
     if (!priv->busy)
@@ -709,7 +1400,7 @@ signon_auth_session_cancel (SignonAuthSession *self)
 
     priv->canceled = TRUE;
     _signon_object_call_when_ready (self,
-                                    auth_session_object_quark(),
+                                    &self->priv->ready_state,
                                     auth_session_cancel_ready_cb,
                                     NULL);
 }
@@ -730,17 +1421,15 @@ auth_session_state_changed_cb (GDBusProxy *proxy,
                     message);
 }
 
-static void auth_session_remote_object_destroyed_cb (GDBusProxy *proxy,
-                                                     gpointer user_data)
+static void
+auth_session_drop_remote_object (SignonAuthSession *self)
 {
-    g_return_if_fail (SIGNON_IS_AUTH_SESSION (user_data));
-    SignonAuthSession *self = SIGNON_AUTH_SESSION (user_data);
     SignonAuthSessionPrivate *priv = self->priv;
-    g_return_if_fail (priv != NULL);
-    DEBUG ("remote object unregistered");
 
     if (priv->proxy)
     {
+        sso_auth_service_unwatch_object (priv->signal_watch);
+        priv->signal_watch = NULL;
         g_object_unref (priv->proxy);
         priv->proxy = NULL;
     }
@@ -753,7 +1442,52 @@ static void auth_session_remote_object_destroyed_cb (GDBusProxy *proxy,
      * */
     priv->busy = FALSE;
     priv->canceled = FALSE;
-    _signon_object_not_ready(self);
+    _signon_object_not_ready (&priv->ready_state);
+}
+
+static void auth_session_remote_object_destroyed_cb (GDBusProxy *proxy,
+                                                     gpointer user_data)
+{
+    g_return_if_fail (SIGNON_IS_AUTH_SESSION (user_data));
+    SignonAuthSession *self = SIGNON_AUTH_SESSION (user_data);
+    g_return_if_fail (self->priv != NULL);
+    DEBUG ("remote object unregistered");
+
+    auth_session_drop_remote_object (self);
+}
+
+static void
+auth_session_signal_cb (GDBusProxy *proxy, const gchar *signal_name,
+                        GVariant *parameters, gpointer user_data)
+{
+    if (g_strcmp0 (signal_name, "stateChanged") == 0 &&
+        g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(is)")))
+    {
+        gint state;
+        gchar *message;
+
+        g_variant_get (parameters, "(is)", &state, &message);
+        auth_session_state_changed_cb (proxy, state, message, user_data);
+        g_free (message);
+    }
+    else if (g_strcmp0 (signal_name, "unregistered") == 0)
+    {
+        auth_session_remote_object_destroyed_cb (proxy, user_data);
+    }
+}
+
+static void
+auth_session_disconnected (gpointer user_data)
+{
+    SignonAuthSession *self = SIGNON_AUTH_SESSION (user_data);
+
+    /* The remote object is requested again from the identity, once it has
+     * been re-registered, by the next operation on this session */
+    if (self->priv->proxy != NULL)
+    {
+        DEBUG ("%s: dropping remote object", G_STRFUNC);
+        auth_session_drop_remote_object (self);
+    }
 }
 
 static gboolean
@@ -789,10 +1523,21 @@ auth_session_query_mechanisms_reply (GObject *object, GAsyncResult *res,
                                                              &error);
     if (SIGNON_IS_NOT_CANCELLED (error))
     {
+        if (error == NULL)
+            _signon_identity_store_mechanisms (cb_data->self->priv->identity,
+                                               cb_data->serial,
+                                               cb_data->self->priv->method_name,
+                                               (const gchar * const *)
+                                               cb_data->wanted_mechanisms,
+                                               mechanisms);
+
         (cb_data->cb) (cb_data->self, mechanisms, error, cb_data->user_data);
     }
+    else
+        g_strfreev (mechanisms);
 
     g_clear_error (&error);
+    g_strfreev (cb_data->wanted_mechanisms);
     g_slice_free (AuthSessionQueryAvailableMechanismsCbData, cb_data);
 }
 
@@ -822,6 +1567,10 @@ auth_session_query_available_mechanisms_ready_cb (gpointer object, const GError
     else
     {
         g_return_if_fail (priv->proxy != NULL);
+        cb_data->wanted_mechanisms =
+            g_strdupv (operation_data->wanted_mechanisms);
+        cb_data->serial =
+            _signon_identity_get_mechanisms_serial (priv->identity);
         sso_auth_session_call_query_available_mechanisms (
             priv->proxy,
             (const char **)operation_data->wanted_mechanisms,
@@ -865,6 +1614,51 @@ auth_session_cancel_ready_cb (gpointer object, const GError *error, gpointer use
     priv->canceled = FALSE;
 }
 
+static void
+auth_session_proxy_new_cb (GObject *object, GAsyncResult *res,
+                           gpointer user_data)
+{
+    SignonAuthSession *self;
+    SignonAuthSessionPrivate *priv;
+    SsoAuthSession *proxy;
+    SsoSignalWatch *signal_watch;
+    GError *error = NULL;
+
+    (void)object;
+
+    proxy = sso_auth_session_proxy_new_finish (res, &error);
+    if (!SIGNON_IS_NOT_CANCELLED (error))
+    {
+        g_clear_error (&error);
+        return;
+    }
+
+    self = SIGNON_AUTH_SESSION (user_data);
+    priv = self->priv;
+    priv->registering = FALSE;
+
+    if (G_LIKELY (error == NULL))
+    {
+        priv->proxy = proxy;
+
+        g_dbus_proxy_set_default_timeout ((GDBusProxy *)priv->proxy,
+                                          G_MAXINT);
+
+        priv->signal_watch =
+            sso_auth_service_watch_object ((GDBusProxy *)priv->proxy,
+                                           auth_session_signal_cb,
+                                           self);
+    }
+    else
+    {
+        g_warning ("Failed to initialize AuthSession proxy: %s",
+                   error->message);
+    }
+
+    _signon_object_ready (self, &priv->ready_state, error);
+    g_clear_error (&error);
+}
+
 static void
 signon_auth_session_complete (SignonAuthSession *self,
                               GError *error,
@@ -877,52 +1671,38 @@ signon_auth_session_complete (SignonAuthSession *self,
 
     DEBUG ("%s %d", G_STRFUNC, __LINE__);
 
-    priv->registering = FALSE;
     if (!g_strcmp0(object_path, "") || error)
     {
+        priv->registering = FALSE;
+
         if (error)
+        {
             DEBUG ("Error message is %s", error->message);
+            _signon_object_ready (self, &priv->ready_state, error);
+        }
         else
-            error = g_error_new (signon_error_quark(),
-                                 SIGNON_ERROR_RUNTIME,
-                                 "Cannot create remote AuthSession object");
-    }
-    else
-    {
-        GError *proxy_error = NULL;
-
-        priv->proxy =
-            sso_auth_session_proxy_new_sync (connection,
-                                             G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
-                                             bus_name,
-                                             object_path,
-                                             priv->cancellable,
-                                             &proxy_error);
-        if (G_UNLIKELY (proxy_error != NULL))
         {
-            g_warning ("Failed to initialize AuthSession proxy: %s",
-                       proxy_error->message);
-            g_clear_error (&proxy_error);
+            GError *new_error = g_error_new (signon_error_quark(),
+                                             SIGNON_ERROR_RUNTIME,
+                                             "Cannot create remote AuthSession object");
+            _signon_object_ready (self, &priv->ready_state, new_error);
+            g_error_free (new_error);
         }
-
-        g_dbus_proxy_set_default_timeout ((GDBusProxy *)priv->proxy,
-                                          G_MAXINT);
-
-        priv->signal_state_changed =
-            g_signal_connect (priv->proxy,
-                              "state-changed",
-                              G_CALLBACK (auth_session_state_changed_cb),
-                              self);
-
-        priv->signal_unregistered =
-           g_signal_connect (priv->proxy,
-                             "unregistered",
-                             G_CALLBACK (auth_session_remote_object_destroyed_cb),
-                             self);
+        return;
     }
 
     DEBUG ("Object path received: %s", object_path);
-    _signon_object_ready (self, auth_session_object_quark (), error);
+
+    /* The session stays in the registering state until the proxy is set up;
+     * the queued operations are released from auth_session_proxy_new_cb() */
+    sso_auth_session_proxy_new (connection,
+                                G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                                G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                                bus_name,
+                                object_path,
+                                priv->cancellable,
+                                auth_session_proxy_new_cb,
+                                self);
 }
 
 static void
@@ -225,10 +225,43 @@ void signon_auth_session_process_async (SignonAuthSession *self,
                                         GCancellable *cancellable,
                                         GAsyncReadyCallback callback,
                                         gpointer user_data);
+void signon_auth_session_process_full (SignonAuthSession *self,
+                                       GVariant *session_data,
+                                       const gchar *mechanism,
+                                       gint priority,
+                                       GCancellable *cancellable,
+                                       GAsyncReadyCallback callback,
+                                       gpointer user_data);
 GVariant *signon_auth_session_process_finish (SignonAuthSession *self,
                                               GAsyncResult *res,
                                               GError **error);
 
+typedef void (*SignonAuthSessionBatchItemCb) (SignonAuthSession *self,
+                                              guint index,
+                                              GVariant *reply,
+                                              const GError *error,
+                                              gpointer user_data);
+void signon_auth_session_process_batch_async (SignonAuthSession *self,
+                                              GVariant *requests,
+                                              GCancellable *cancellable,
+                                              SignonAuthSessionBatchItemCb item_cb,
+                                              gpointer item_data,
+                                              GAsyncReadyCallback callback,
+                                              gpointer user_data);
+gboolean signon_auth_session_process_batch_finish (SignonAuthSession *self,
+                                                   GAsyncResult *res,
+                                                   GError **error);
+
+void signon_auth_session_set_queue_limits (SignonAuthSession *self,
+                                           guint max_in_flight,
+                                           guint max_pending);
+guint signon_auth_session_get_pending_requests (SignonAuthSession *self);
+
+void signon_auth_session_set_result_cache_lifetime (SignonAuthSession *self,
+                                                    guint max_lifetime);
+void signon_auth_session_set_share_requests (SignonAuthSession *self,
+                                             gboolean share);
+
 void signon_auth_session_cancel(SignonAuthSession *self);
 
 G_END_DECLS
@@ -24,146 +24,104 @@
 
 #include "signon-dbus-queue.h"
 
+/* The list link is embedded, so that queueing a callback costs a single
+ * slice allocation and appending to the queue is O(1) */
 typedef struct {
+    GList link;
     SignonReadyCb callback;
     gpointer user_data;
 } SignonReadyCbData;
 
-typedef struct {
-    gpointer self;
-    GSList *callbacks;
-} SignonReadyData;
-
-static GQuark
-_signon_object_ready_quark()
-{
-  static GQuark quark = 0;
-
-  if (!quark)
-    quark = g_quark_from_static_string ("signon_object_ready_quark");
-
-  return quark;
-}
-
-static GQuark
-_signon_object_error_quark()
-{
-  static GQuark quark = 0;
-
-  if (!quark)
-    quark = g_quark_from_static_string ("signon_object_error_quark");
-
-  return quark;
-}
-
 static void
-signon_object_invoke_ready_callbacks (SignonReadyData *rd, const GError *error)
+signon_object_invoke_ready_callbacks (GQueue *callbacks, gpointer object,
+                                      const GError *error)
 {
-    GSList *list;
+    GList *link;
 
-    for (list = rd->callbacks; list != NULL; list = list->next)
+    while ((link = g_queue_pop_head_link (callbacks)) != NULL)
     {
-        SignonReadyCbData *cb = list->data;
+        SignonReadyCbData *cb = link->data;
 
-        cb->callback (rd->self, error, cb->user_data);
+        cb->callback (object, error, cb->user_data);
         g_slice_free (SignonReadyCbData, cb);
     }
-    g_slist_free (rd->callbacks);
 }
 
-static void
-signon_ready_data_free (SignonReadyData *rd)
+void
+_signon_ready_state_init (SignonReadyState *state)
 {
-    if (rd->self)
-    {
-        //TODO: Signon error codes need be presented instead of 555 and 666
-        GError error = { 555, 666, "Object disposed" };
-        signon_object_invoke_ready_callbacks (rd, &error);
-    }
-    g_slice_free (SignonReadyData, rd);
+    state->ready = FALSE;
+    state->error = NULL;
+    g_queue_init (&state->callbacks);
 }
 
 void
-_signon_object_call_when_ready (gpointer object, GQuark quark, SignonReadyCb callback,
-                                gpointer user_data)
+_signon_ready_state_clear (SignonReadyState *state, gpointer object)
+{
+    //TODO: Signon error codes need be presented instead of 555 and 666
+    GError error = { 555, 666, "Object disposed" };
+
+    signon_object_invoke_ready_callbacks (&state->callbacks, object, &error);
+    g_clear_error (&state->error);
+    state->ready = FALSE;
+}
+
+void
+_signon_object_call_when_ready (gpointer object, SignonReadyState *state,
+                                SignonReadyCb callback, gpointer user_data)
 {
-    SignonReadyData *rd;
     SignonReadyCbData *cb;
 
     g_return_if_fail (G_IS_OBJECT (object));
-    g_return_if_fail (quark != 0);
+    g_return_if_fail (state != NULL);
     g_return_if_fail (callback != NULL);
 
-    if (GPOINTER_TO_INT (g_object_get_qdata((GObject *)object,
-                           _signon_object_ready_quark())) == TRUE)
+    if (state->ready)
     {
         //TODO: specify the last error in object initialization
-        GError * err = g_object_get_qdata((GObject *)object,
-                                          _signon_object_error_quark());
-        return (*callback)(object, err, user_data);
+        return (*callback)(object, state->error, user_data);
     }
 
-    cb = g_slice_new (SignonReadyCbData);
+    cb = g_slice_new0 (SignonReadyCbData);
+    cb->link.data = cb;
     cb->callback = callback;
     cb->user_data = user_data;
 
-    rd = g_object_get_qdata ((GObject *)object, quark);
-    if (!rd)
-    {
-        rd = g_slice_new (SignonReadyData);
-        rd->self = object;
-        rd->callbacks = NULL;
-        g_object_set_qdata_full ((GObject *)object, quark, rd,
-                                 (GDestroyNotify)signon_ready_data_free);
-    }
-
-    rd->callbacks = g_slist_append (rd->callbacks, cb);
+    g_queue_push_tail_link (&state->callbacks, &cb->link);
 }
 
 void
-_signon_object_ready (gpointer object, GQuark quark, const GError *error)
+_signon_object_ready (gpointer object, SignonReadyState *state,
+                      const GError *error)
 {
-    SignonReadyData *rd;
+    GQueue callbacks;
 
-    g_object_set_qdata((GObject *)object, _signon_object_ready_quark(), GINT_TO_POINTER(TRUE));
+    state->ready = TRUE;
 
-    if(error)
-        g_object_set_qdata_full ((GObject *)object, _signon_object_error_quark(),
-                                  g_error_copy(error),
-                                 (GDestroyNotify)g_error_free);
+    g_clear_error (&state->error);
+    if (error)
+        state->error = g_error_copy (error);
 
-    /* steal the qdata so the callbacks won't be invoked again, even if the
+    /* detach the queue so the callbacks won't be invoked again, even if the
      * object becomes ready or is finalized while still invoking them */
-
-    rd = g_object_steal_qdata ((GObject *)object, quark);
-    if (!rd) return;
+    callbacks = state->callbacks;
+    g_queue_init (&state->callbacks);
+    if (callbacks.head == NULL) return;
 
     g_object_ref (object);
-
-    signon_object_invoke_ready_callbacks (rd, error);
-    rd->self = NULL; /* so the callbacks won't be invoked again */
-    signon_ready_data_free (rd);
-
+    signon_object_invoke_ready_callbacks (&callbacks, object, error);
     g_object_unref (object);
-
-    //TODO: set some sort of ready information
 }
 
 void
-_signon_object_not_ready (gpointer object)
+_signon_object_not_ready (SignonReadyState *state)
 {
-    g_object_set_qdata ((GObject *)object,
-                        _signon_object_ready_quark(),
-                        GINT_TO_POINTER(FALSE));
-
-    g_object_set_qdata ((GObject *)object,
-                        _signon_object_error_quark(),
-                        NULL);
+    state->ready = FALSE;
+    g_clear_error (&state->error);
 }
 
 const GError *
-_signon_object_last_error (gpointer object)
+_signon_object_last_error (SignonReadyState *state)
 {
-    return g_object_get_qdata((GObject *)object,
-                              _signon_object_error_quark());
+    return state->error;
 }
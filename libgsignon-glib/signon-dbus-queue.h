@@ -33,13 +33,27 @@ G_BEGIN_DECLS
 typedef void (*SignonReadyCb) (gpointer object, const GError *error,
                                gpointer user_data);
 
-void _signon_object_call_when_ready (gpointer object, GQuark quark,
+/*
+ * Readiness of an object talking to the daemon, embedded in the object's
+ * private data: checking it is a plain pointer dereference.
+ */
+typedef struct {
+    gboolean ready;
+    GError *error;
+    GQueue callbacks;
+} SignonReadyState;
+
+void _signon_ready_state_init (SignonReadyState *state);
+void _signon_ready_state_clear (SignonReadyState *state, gpointer object);
+
+void _signon_object_call_when_ready (gpointer object, SignonReadyState *state,
                                     SignonReadyCb callback, gpointer user_data);
 
-void _signon_object_ready (gpointer object, GQuark quark, const GError *error);
-void _signon_object_not_ready (gpointer object);
+void _signon_object_ready (gpointer object, SignonReadyState *state,
+                           const GError *error);
+void _signon_object_not_ready (SignonReadyState *state);
 
-const GError *_signon_object_last_error (gpointer object);
+const GError *_signon_object_last_error (SignonReadyState *state);
 
 G_END_DECLS
 #endif /* SIGNONDBUSQUEUEDDATA_H */
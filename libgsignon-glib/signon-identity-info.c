@@ -47,6 +47,131 @@ G_DEFINE_BOXED_TYPE (SignonIdentityInfo, signon_identity_info,
                      (GBoxedFreeFunc)signon_identity_info_free);
 
 
+/*
+ * Infos created from a daemon reply keep a reference on the serialized
+ * a{sv} and decode each field the first time it is accessed: listings
+ * typically look only at a couple of fields of each identity.
+ * pending_fields holds the #SignonIdentityInfoField flags still to decode.
+ */
+/* bit of pending_fields used as a lock while decoding */
+#define INFO_LOCK_BIT 31
+
+static void
+identity_info_decode (SignonIdentityInfo *info, gint field)
+{
+    GVariant *variant = info->variant;
+    GVariant *value;
+
+    switch (field)
+    {
+    case SIGNON_IDENTITY_INFO_FIELD_ID:
+        g_variant_lookup (variant, SIGNOND_IDENTITY_INFO_ID, "u", &info->id);
+        break;
+    case SIGNON_IDENTITY_INFO_FIELD_USERNAME:
+        g_variant_lookup (variant, SIGNOND_IDENTITY_INFO_USERNAME, "s",
+                          &info->username);
+        break;
+    case SIGNON_IDENTITY_INFO_FIELD_SECRET:
+        g_variant_lookup (variant, SIGNOND_IDENTITY_INFO_SECRET, "s",
+                          &info->secret);
+        break;
+    case SIGNON_IDENTITY_INFO_FIELD_STORE_SECRET:
+        g_variant_lookup (variant, SIGNOND_IDENTITY_INFO_STORESECRET, "b",
+                          &info->store_secret);
+        break;
+    case SIGNON_IDENTITY_INFO_FIELD_CAPTION:
+        g_variant_lookup (variant, SIGNOND_IDENTITY_INFO_CAPTION, "s",
+                          &info->caption);
+        break;
+    case SIGNON_IDENTITY_INFO_FIELD_METHODS:
+        info->methods = g_hash_table_new_full (g_str_hash,
+                                               g_str_equal,
+                                               g_free,
+                                               (GDestroyNotify) g_strfreev);
+        if (g_variant_lookup (variant,
+                              SIGNOND_IDENTITY_INFO_AUTHMETHODS,
+                              "@a{sas}",
+                              &value))
+        {
+            GVariantIter iter;
+            gchar *method;
+            gchar **mechanisms;
+
+            g_variant_iter_init (&iter, value);
+            while (g_variant_iter_next (&iter, "{s^as}", &method, &mechanisms))
+            {
+                g_hash_table_insert (info->methods, method, mechanisms);
+            }
+            g_variant_unref (value);
+        }
+        break;
+    case SIGNON_IDENTITY_INFO_FIELD_REALMS:
+        g_variant_lookup (variant, SIGNOND_IDENTITY_INFO_REALMS, "^as",
+                          &info->realms);
+        break;
+    case SIGNON_IDENTITY_INFO_FIELD_OWNER:
+        if (g_variant_lookup (variant,
+                              SIGNOND_IDENTITY_INFO_OWNER,
+                              "@(ss)",
+                              &value))
+        {
+            info->owner = signon_security_context_deconstruct_variant (value);
+            g_variant_unref (value);
+        }
+        break;
+    case SIGNON_IDENTITY_INFO_FIELD_ACL:
+        if (g_variant_lookup (variant,
+                              SIGNOND_IDENTITY_INFO_ACL,
+                              "@a(ss)",
+                              &value))
+        {
+            info->access_control_list =
+                signon_security_context_list_deconstruct_variant (value);
+            g_variant_unref (value);
+        }
+        break;
+    case SIGNON_IDENTITY_INFO_FIELD_TYPE:
+        g_variant_lookup (variant, SIGNOND_IDENTITY_INFO_TYPE, "u",
+                          &info->type);
+        break;
+    default:
+        g_assert_not_reached ();
+    }
+}
+
+static void
+identity_info_ensure (const SignonIdentityInfo *const_info, gint fields)
+{
+    SignonIdentityInfo *info = (SignonIdentityInfo *)const_info;
+    gint pending;
+    gint field;
+
+    if (G_LIKELY ((g_atomic_int_get (&info->pending_fields) & fields) == 0))
+        return;
+
+    g_bit_lock (&info->pending_fields, INFO_LOCK_BIT);
+
+    pending = g_atomic_int_get (&info->pending_fields) & fields &
+        SIGNON_IDENTITY_INFO_FIELD_ALL;
+    for (field = 1; pending != 0; field <<= 1)
+    {
+        if ((pending & field) == 0)
+            continue;
+        identity_info_decode (info, field);
+        pending &= ~field;
+        g_atomic_int_and ((volatile guint *)&info->pending_fields, ~field);
+    }
+
+    if ((g_atomic_int_get (&info->pending_fields) &
+         SIGNON_IDENTITY_INFO_FIELD_ALL) == 0)
+    {
+        g_variant_unref (info->variant);
+        info->variant = NULL;
+    }
+
+    g_bit_unlock (&info->pending_fields, INFO_LOCK_BIT);
+}
+
 static GVariant *
 signon_variant_new_string (const gchar *string)
 {
@@ -57,6 +182,7 @@ static const gchar *identity_info_get_secret (const SignonIdentityInfo *info)
 {
     g_return_val_if_fail (info != NULL, NULL);
 
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_SECRET);
     return info->secret;
 }
 
@@ -65,6 +191,7 @@ static void identity_info_set_id (SignonIdentityInfo *info, gint id)
     g_return_if_fail (info != NULL);
     g_return_if_fail (id >= 0);
 
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_ID);
     info->id = id;
 }
 
@@ -98,6 +225,7 @@ void signon_identity_info_set_methods (SignonIdentityInfo *info,
                                g_free,
                                (GDestroyNotify) g_strfreev);
     g_hash_table_foreach (methods, identity_methods_copy, new_methods);
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_METHODS);
     g_hash_table_unref (info->methods);
     info->methods = new_methods;
 }
@@ -121,96 +249,78 @@ void signon_identity_info_own_methods (SignonIdentityInfo *info,
     DEBUG("%s", G_STRFUNC);
 
     g_hash_table_ref (methods);
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_METHODS);
+    g_hash_table_unref (info->methods);
     info->methods = methods;
 }
 
 SignonIdentityInfo *
 signon_identity_info_new_from_variant (GVariant *variant)
 {
-    GVariant *method_map;
-    GVariant *owner;
-    GVariant *acl;
+    return signon_identity_info_new_from_variant_fields (variant,
+                                               SIGNON_IDENTITY_INFO_FIELD_ALL);
+}
+
+/*
+ * Only @fields are ever decoded from @variant; the others are left empty,
+ * even if the daemon sent them.
+ */
+SignonIdentityInfo *
+signon_identity_info_new_from_variant_fields (GVariant *variant,
+                                              SignonIdentityInfoField fields)
+{
+    SignonIdentityInfo *info;
 
     if (!variant)
         return NULL;
 
-    SignonIdentityInfo *info = signon_identity_info_new ();
-
     DEBUG("%s: ", G_STRFUNC);
 
-    g_variant_lookup (variant,
-                      SIGNOND_IDENTITY_INFO_ID,
-                      "u",
-                      &info->id);
-
-    g_variant_lookup (variant,
-                      SIGNOND_IDENTITY_INFO_USERNAME,
-                      "s",
-                      &info->username);
-
-    g_variant_lookup (variant,
-                      SIGNOND_IDENTITY_INFO_SECRET,
-                      "s",
-                      &info->secret);
-
-    g_variant_lookup (variant,
-                      SIGNOND_IDENTITY_INFO_STORESECRET,
-                      "b",
-                      &info->store_secret);
-
-    g_variant_lookup (variant,
-                      SIGNOND_IDENTITY_INFO_CAPTION,
-                      "s",
-                      &info->caption);
-
-    g_variant_lookup (variant,
-                      SIGNOND_IDENTITY_INFO_REALMS,
-                      "^as",
-                      &info->realms);
-
-    /* get the methods */
-    if (g_variant_lookup (variant,
-                          SIGNOND_IDENTITY_INFO_AUTHMETHODS,
-                          "@a{sas}",
-                          &method_map))
-    {
-        GVariantIter iter;
-        gchar *method;
-        gchar **mechanisms;
+    info = g_slice_new0 (SignonIdentityInfo);
+    info->variant = g_variant_ref (variant);
+    info->pending_fields = fields & SIGNON_IDENTITY_INFO_FIELD_ALL;
 
-        g_variant_iter_init (&iter, method_map);
-        while (g_variant_iter_next (&iter, "{s^as}", &method, &mechanisms))
-        {
-            g_hash_table_insert (info->methods, method, mechanisms);
-        }
-        g_variant_unref (method_map);
-    }
+    /* the table is always there, even when it's not decoded */
+    if (!(fields & SIGNON_IDENTITY_INFO_FIELD_METHODS))
+        info->methods = g_hash_table_new_full (g_str_hash,
+                                               g_str_equal,
+                                               g_free,
+                                               (GDestroyNotify) g_strfreev);
 
-    if (g_variant_lookup (variant,
-                      SIGNOND_IDENTITY_INFO_OWNER,
-                      "@(ss)",
-                      &owner))
-    {
-        info->owner = signon_security_context_deconstruct_variant (owner);
-        g_variant_unref (owner);
-    }
+    return info;
+}
 
-    if (g_variant_lookup (variant,
-                          SIGNOND_IDENTITY_INFO_ACL,
-                          "@a(ss)",
-                          &acl))
+GVariant *
+signon_identity_info_fields_to_variant (SignonIdentityInfoField fields)
+{
+    static const struct {
+        SignonIdentityInfoField field;
+        const gchar *key;
+    } keys[] = {
+        { SIGNON_IDENTITY_INFO_FIELD_ID, SIGNOND_IDENTITY_INFO_ID },
+        { SIGNON_IDENTITY_INFO_FIELD_USERNAME, SIGNOND_IDENTITY_INFO_USERNAME },
+        { SIGNON_IDENTITY_INFO_FIELD_SECRET, SIGNOND_IDENTITY_INFO_SECRET },
+        { SIGNON_IDENTITY_INFO_FIELD_STORE_SECRET,
+            SIGNOND_IDENTITY_INFO_STORESECRET },
+        { SIGNON_IDENTITY_INFO_FIELD_CAPTION, SIGNOND_IDENTITY_INFO_CAPTION },
+        { SIGNON_IDENTITY_INFO_FIELD_METHODS,
+            SIGNOND_IDENTITY_INFO_AUTHMETHODS },
+        { SIGNON_IDENTITY_INFO_FIELD_REALMS, SIGNOND_IDENTITY_INFO_REALMS },
+        { SIGNON_IDENTITY_INFO_FIELD_OWNER, SIGNOND_IDENTITY_INFO_OWNER },
+        { SIGNON_IDENTITY_INFO_FIELD_ACL, SIGNOND_IDENTITY_INFO_ACL },
+        { SIGNON_IDENTITY_INFO_FIELD_TYPE, SIGNOND_IDENTITY_INFO_TYPE },
+    };
+    GVariantBuilder builder;
+    guint i;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_STRING_ARRAY);
+    for (i = 0; i < G_N_ELEMENTS (keys); i++)
     {
-        info->access_control_list =
-            signon_security_context_list_deconstruct_variant (acl);
-        g_variant_unref (acl);
+        if (fields & keys[i].field)
+            g_variant_builder_add (&builder, "s", keys[i].key);
     }
 
-    g_variant_lookup (variant,
-                      SIGNOND_IDENTITY_INFO_TYPE,
-                      "u",
-                      &info->type);
-
-    return info;
+    return g_variant_builder_end (&builder);
 }
 
 GVariant *
@@ -223,6 +333,8 @@ signon_identity_info_to_variant (const SignonIdentityInfo *self)
     const gchar *method;
     const gchar **mechanisms;
 
+    identity_info_ensure (self, SIGNON_IDENTITY_INFO_FIELD_ALL);
+
     g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
 
     g_variant_builder_add (&builder, "{sv}",
@@ -339,12 +451,16 @@ void signon_identity_info_free (SignonIdentityInfo *info)
     g_free (info->secret);
     g_free (info->caption);
 
-    g_hash_table_unref (info->methods);
+    if (info->methods)
+        g_hash_table_unref (info->methods);
 
     g_strfreev (info->realms);
     signon_security_context_free (info->owner);
     signon_security_context_list_free (info->access_control_list);
 
+    if (info->variant)
+        g_variant_unref (info->variant);
+
     g_slice_free (SignonIdentityInfo, info);
 }
 
@@ -401,6 +517,7 @@ SignonIdentityInfo *signon_identity_info_copy (const SignonIdentityInfo *other)
 gint signon_identity_info_get_id (const SignonIdentityInfo *info)
 {
     g_return_val_if_fail (info != NULL, -1);
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_ID);
     return info->id;
 }
 
@@ -415,6 +532,7 @@ gint signon_identity_info_get_id (const SignonIdentityInfo *info)
 const gchar *signon_identity_info_get_username (const SignonIdentityInfo *info)
 {
     g_return_val_if_fail (info != NULL, NULL);
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_USERNAME);
     return info->username;
 }
 
@@ -429,6 +547,7 @@ const gchar *signon_identity_info_get_username (const SignonIdentityInfo *info)
 gboolean signon_identity_info_get_storing_secret (const SignonIdentityInfo *info)
 {
     g_return_val_if_fail (info != NULL, FALSE);
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_STORE_SECRET);
     return info->store_secret;
 }
 
@@ -443,6 +562,7 @@ gboolean signon_identity_info_get_storing_secret (const SignonIdentityInfo *info
 const gchar *signon_identity_info_get_caption (const SignonIdentityInfo *info)
 {
     g_return_val_if_fail (info != NULL, NULL);
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_CAPTION);
     return info->caption;
 }
 
@@ -459,6 +579,7 @@ const gchar *signon_identity_info_get_caption (const SignonIdentityInfo *info)
 GHashTable *signon_identity_info_get_methods (const SignonIdentityInfo *info)
 {
     g_return_val_if_fail (info != NULL, NULL);
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_METHODS);
     return info->methods;
 }
 
@@ -473,6 +594,7 @@ GHashTable *signon_identity_info_get_methods (const SignonIdentityInfo *info)
 const gchar* const *signon_identity_info_get_realms (const SignonIdentityInfo *info)
 {
     g_return_val_if_fail (info != NULL, NULL);
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_REALMS);
     return (const gchar* const *)info->realms;
 }
 
@@ -487,6 +609,7 @@ const gchar* const *signon_identity_info_get_realms (const SignonIdentityInfo *i
 const SignonSecurityContext *signon_identity_info_get_owner (const SignonIdentityInfo *info)
 {
     g_return_val_if_fail (info != NULL, NULL);
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_OWNER);
     return info->owner;
 }
 
@@ -501,6 +624,7 @@ const SignonSecurityContext *signon_identity_info_get_owner (const SignonIdentit
 SignonSecurityContextList *signon_identity_info_get_access_control_list (const SignonIdentityInfo *info)
 {
     g_return_val_if_fail (info != NULL, NULL);
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_ACL);
     return info->access_control_list;
 }
 
@@ -515,6 +639,7 @@ SignonSecurityContextList *signon_identity_info_get_access_control_list (const S
 SignonIdentityType signon_identity_info_get_identity_type (const SignonIdentityInfo *info)
 {
     g_return_val_if_fail (info != NULL, -1);
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_TYPE);
     return (SignonIdentityType)info->type;
 }
 
@@ -539,6 +664,7 @@ void signon_identity_info_set_username (SignonIdentityInfo *info,
 {
     g_return_if_fail (info != NULL);
 
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_USERNAME);
     _replace_string (&info->username, username);
 }
 
@@ -558,6 +684,8 @@ void signon_identity_info_set_secret (SignonIdentityInfo *info,
 {
     g_return_if_fail (info != NULL);
 
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_SECRET |
+                          SIGNON_IDENTITY_INFO_FIELD_STORE_SECRET);
     _replace_string (&info->secret, secret);
     info->store_secret = store_secret;
 }
@@ -575,6 +703,7 @@ void signon_identity_info_set_caption (SignonIdentityInfo *info,
 {
     g_return_if_fail (info != NULL);
 
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_CAPTION);
     _replace_string (&info->caption, caption);
 }
 
@@ -590,11 +719,10 @@ void signon_identity_info_set_method (SignonIdentityInfo *info, const gchar *met
                                       const gchar* const *mechanisms)
 {
     g_return_if_fail (info != NULL);
-
-    g_return_if_fail (info->methods != NULL);
     g_return_if_fail (method != NULL);
     g_return_if_fail (mechanisms != NULL);
 
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_METHODS);
     g_hash_table_replace (info->methods,
                           g_strdup(method), g_strdupv((gchar **)mechanisms));
 }
@@ -609,8 +737,8 @@ void signon_identity_info_set_method (SignonIdentityInfo *info, const gchar *met
 void signon_identity_info_remove_method (SignonIdentityInfo *info, const gchar *method)
 {
     g_return_if_fail (info != NULL);
-    g_return_if_fail (info->methods != NULL);
 
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_METHODS);
     g_hash_table_remove (info->methods, method);
 }
 
@@ -628,6 +756,7 @@ void signon_identity_info_set_realms (SignonIdentityInfo *info,
 
     gchar **new_realms = g_strdupv ((gchar **) realms);
 
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_REALMS);
     if (info->realms) g_strfreev (info->realms);
 
     info->realms = new_realms;
@@ -647,6 +776,7 @@ void signon_identity_info_set_owner (SignonIdentityInfo *info,
 
     SignonSecurityContext *new_owner = signon_security_context_copy (owner);
 
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_OWNER);
     if (info->owner) signon_security_context_free (info->owner);
 
     info->owner = new_owner;
@@ -669,6 +799,7 @@ void signon_identity_info_set_owner_from_values (
                       system_context != NULL &&
                       application_context != NULL);
 
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_OWNER);
     if (info->owner) signon_security_context_free (info->owner);
 
     info->owner = signon_security_context_new_from_values(system_context,
@@ -690,6 +821,7 @@ void signon_identity_info_set_access_control_list (SignonIdentityInfo *info,
     SignonSecurityContextList *new_acl =
         signon_security_context_list_copy (access_control_list);
 
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_ACL);
     if (info->access_control_list)
         signon_security_context_list_free (info->access_control_list);
 
@@ -710,6 +842,7 @@ void signon_identity_info_access_control_list_append (
     g_return_if_fail (info != NULL);
     g_return_if_fail (security_context != NULL);
 
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_ACL);
     info->access_control_list = g_list_append (info->access_control_list,
                                                security_context);
 }
@@ -725,5 +858,6 @@ void signon_identity_info_set_identity_type (SignonIdentityInfo *info,
                                              SignonIdentityType type)
 {
     g_return_if_fail (info != NULL);
+    identity_info_ensure (info, SIGNON_IDENTITY_INFO_FIELD_TYPE);
     info->type = (gint) type;
 }
@@ -57,6 +57,37 @@ typedef enum {
     SIGNON_IDENTITY_TYPE_NETWORK = 1 << 2
 } SignonIdentityType;
 
+/**
+ * SignonIdentityInfoField:
+ * @SIGNON_IDENTITY_INFO_FIELD_ID: the identity ID
+ * @SIGNON_IDENTITY_INFO_FIELD_USERNAME: the username
+ * @SIGNON_IDENTITY_INFO_FIELD_SECRET: the secret
+ * @SIGNON_IDENTITY_INFO_FIELD_STORE_SECRET: whether the secret is stored
+ * @SIGNON_IDENTITY_INFO_FIELD_CAPTION: the caption
+ * @SIGNON_IDENTITY_INFO_FIELD_METHODS: the allowed methods and mechanisms
+ * @SIGNON_IDENTITY_INFO_FIELD_REALMS: the allowed realms
+ * @SIGNON_IDENTITY_INFO_FIELD_OWNER: the owner's security context
+ * @SIGNON_IDENTITY_INFO_FIELD_ACL: the access control list
+ * @SIGNON_IDENTITY_INFO_FIELD_TYPE: the identity type
+ * @SIGNON_IDENTITY_INFO_FIELD_ALL: all of the above
+ *
+ * Fields of a #SignonIdentityInfo, used to select which of them are
+ * retrieved by signon_auth_service_query_identities_with_fields().
+ */
+typedef enum {
+    SIGNON_IDENTITY_INFO_FIELD_ID = 1 << 0,
+    SIGNON_IDENTITY_INFO_FIELD_USERNAME = 1 << 1,
+    SIGNON_IDENTITY_INFO_FIELD_SECRET = 1 << 2,
+    SIGNON_IDENTITY_INFO_FIELD_STORE_SECRET = 1 << 3,
+    SIGNON_IDENTITY_INFO_FIELD_CAPTION = 1 << 4,
+    SIGNON_IDENTITY_INFO_FIELD_METHODS = 1 << 5,
+    SIGNON_IDENTITY_INFO_FIELD_REALMS = 1 << 6,
+    SIGNON_IDENTITY_INFO_FIELD_OWNER = 1 << 7,
+    SIGNON_IDENTITY_INFO_FIELD_ACL = 1 << 8,
+    SIGNON_IDENTITY_INFO_FIELD_TYPE = 1 << 9,
+    SIGNON_IDENTITY_INFO_FIELD_ALL = (1 << 10) - 1
+} SignonIdentityInfoField;
+
 GType signon_identity_info_get_type (void) G_GNUC_CONST;
 
 SignonIdentityInfo *signon_identity_info_new ();
@@ -157,23 +157,46 @@ typedef enum  {
 struct _SignonIdentityPrivate
 {
     SsoIdentity *proxy;
+    SsoSignalWatch *signal_watch;
     SsoAuthService *auth_service_proxy;
     GCancellable *cancellable;
 
     SignonIdentityInfo *identity_info;
+    guint info_generation;
+    /* key this identity is counted under in the info cache users */
+    gchar *info_cache_key;
+    /* connection generation the registration in flight was started on */
+    guint registration_generation;
 
     GSList *sessions;
+    GHashTable *session_counts;
+    guint max_sessions_per_method;
     IdentityRegistrationState registration_state;
 
     gboolean removed;
     gboolean signed_out;
     gboolean updated;
 
+    /* A store made through this object is notified twice, by its reply
+     * and by the infoUpdated signal: only the first one is logged */
+    guint stores_in_flight;
+    gboolean store_logged_by_signal;
+    gboolean store_echo_pending;
+
     guint id;
     gchar *app_ctx;
 
-    guint signal_info_updated;
-    guint signal_unregistered;
+    SsoDisconnectHook *disconnect_hook;
+
+    GHashTable *mechanisms_cache;
+    guint mechanisms_serial;
+
+    GHashTable *results_cache;
+    guint results_serial;
+
+    GHashTable *shared_requests;
+
+    SignonReadyState ready_state;
 };
 
 enum {
@@ -216,7 +239,7 @@ typedef struct _IdentitySessionCbData
 
 typedef struct _IdentitySessionData
 {
-    const gchar *method;
+    gchar *method;
     gpointer cb_data;
 } IdentitySessionData;
 
@@ -236,11 +259,25 @@ typedef struct _IdentityVerifyData
     gpointer cb_data;
 } IdentityVerifyData;
 
+typedef struct _IdentityCachedResult
+{
+    GVariant *reply;
+    gint64 expires;
+} IdentityCachedResult;
+
+/* Data of the weak reference an identity keeps on each of its sessions */
+typedef struct _IdentitySessionLink
+{
+    SignonIdentity *identity;
+    gchar *method;
+} IdentitySessionLink;
+
 typedef struct _IdentityInfoCbData
 {
     SignonIdentity *self;
     SignonIdentityInfoCb cb;
     gpointer user_data;
+    guint info_generation;
 } IdentityInfoCbData;
 
 typedef struct _IdentityCredentialsUpdateCbData
@@ -276,6 +313,8 @@ static void identity_credentials_update_ready_cb (gpointer object, const GError
 static void identity_signout_ready_cb (gpointer object, const GError *error, gpointer user_data);
 static void identity_info_ready_cb (gpointer object, const GError *error, gpointer user_data);
 
+static void identity_disconnected (gpointer user_data);
+
 static void identity_process_signout (SignonIdentity *self);
 static void identity_process_updated (SignonIdentity *self);
 static void identity_process_removed (SignonIdentity *self);
@@ -286,17 +325,8 @@ static void identity_session_ready_cb (gpointer object, const GError *error,
                                        gpointer user_data);
 static void identity_session_object_destroyed_cb (gpointer data,
                                                   GObject *where_the_session_was);
-
-static GQuark
-identity_object_quark ()
-{
-  static GQuark quark = 0;
-
-  if (!quark)
-    quark = g_quark_from_static_string ("identity_object_quark");
-
-  return quark;
-}
+static void identity_cached_result_free (IdentityCachedResult *result);
+static void identity_info_cache_release (SignonIdentity *self);
 
 static void
 signon_identity_set_property (GObject *object,
@@ -353,16 +383,35 @@ signon_identity_init (SignonIdentity *identity)
                                                   SignonIdentityPrivate);
 
     priv = identity->priv;
+    _signon_ready_state_init (&priv->ready_state);
     priv->proxy = NULL;
-    priv->auth_service_proxy = sso_auth_service_get_instance();
+    priv->auth_service_proxy = sso_auth_service_peek_instance ();
     priv->cancellable = g_cancellable_new ();
     priv->registration_state = NOT_REGISTERED;
+    priv->disconnect_hook =
+        sso_auth_service_add_disconnect_hook (identity_disconnected, identity);
 
     priv->removed = FALSE;
     priv->signed_out = FALSE;
     priv->updated = FALSE;
 
     priv->app_ctx = NULL;
+
+    priv->mechanisms_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                    g_free,
+                                                    (GDestroyNotify)g_strfreev);
+
+    priv->session_counts = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  g_free, NULL);
+
+    priv->results_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free,
+                                                 (GDestroyNotify)
+                                                 identity_cached_result_free);
+
+    priv->shared_requests = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   g_free, NULL);
+    priv->max_sessions_per_method = 1;
 }
 
 static void
@@ -371,6 +420,12 @@ signon_identity_dispose (GObject *object)
     SignonIdentity *identity = SIGNON_IDENTITY (object);
     SignonIdentityPrivate *priv = identity->priv;
 
+    if (priv->disconnect_hook)
+    {
+        sso_auth_service_remove_disconnect_hook (priv->disconnect_hook);
+        priv->disconnect_hook = NULL;
+    }
+
     if (priv->cancellable)
     {
         g_cancellable_cancel (priv->cancellable);
@@ -378,6 +433,8 @@ signon_identity_dispose (GObject *object)
         priv->cancellable = NULL;
     }
 
+    identity_info_cache_release (identity);
+
     if (priv->identity_info)
     {
         signon_identity_info_free (priv->identity_info);
@@ -388,8 +445,8 @@ signon_identity_dispose (GObject *object)
 
     if (priv->proxy)
     {
-        g_signal_handler_disconnect (priv->proxy, priv->signal_info_updated);
-        g_signal_handler_disconnect (priv->proxy, priv->signal_unregistered);
+        sso_auth_service_unwatch_object (priv->signal_watch);
+        priv->signal_watch = NULL;
         g_object_unref (priv->proxy);
         priv->proxy = NULL;
     }
@@ -404,6 +461,14 @@ static void
 signon_identity_finalize (GObject *object)
 {
     SignonIdentity *identity = SIGNON_IDENTITY (object);
+
+    _signon_ready_state_clear (&identity->priv->ready_state, object);
+
+    g_hash_table_unref (identity->priv->mechanisms_cache);
+    g_hash_table_unref (identity->priv->session_counts);
+    g_hash_table_unref (identity->priv->results_cache);
+    g_hash_table_unref (identity->priv->shared_requests);
+
     if (identity->priv->app_ctx)
     {
         g_free(identity->priv->app_ctx);
@@ -477,6 +542,559 @@ signon_identity_class_init (SignonIdentityClass *klass)
     object_class->finalize = signon_identity_finalize;
 }
 
+static gchar *
+identity_key (guint32 id, const gchar *application_context)
+{
+    return g_strdup_printf ("%u:%s", id,
+                            application_context ? application_context : "");
+}
+
+/*
+ * Process-wide cache of the identity data fetched from signond, keyed by
+ * (id, application context). The entries are the serialized replies, which
+ * are immutable: each SignonIdentity decodes its own SignonIdentityInfo out
+ * of them, so that what the application does with it doesn't leak to the
+ * other identities opened on the same record. The generation counter is
+ * bumped on every invalidation so that replies to requests issued before it
+ * are not cached.
+ * info_cache_users counts the identities which looked up or stored each
+ * key: an entry is dropped when the last of them goes away, and the entries
+ * without users are dropped when the cache grows beyond
+ * IDENTITY_INFO_CACHE_SIZE.
+ */
+#define IDENTITY_INFO_CACHE_SIZE 64
+
+static GHashTable *info_cache = NULL;
+static GHashTable *info_cache_users = NULL;
+static guint info_cache_generation = 0;
+static GMutex info_cache_mutex;
+
+static guint
+identity_info_cache_generation (void)
+{
+    guint generation;
+
+    g_mutex_lock (&info_cache_mutex);
+    generation = info_cache_generation;
+    g_mutex_unlock (&info_cache_mutex);
+
+    return generation;
+}
+
+static void
+identity_info_cache_unuse_locked (SignonIdentityPrivate *priv)
+{
+    guint users;
+
+    if (priv->info_cache_key == NULL)
+        return;
+
+    users = GPOINTER_TO_UINT (g_hash_table_lookup (info_cache_users,
+                                                   priv->info_cache_key));
+    if (users > 1)
+        g_hash_table_insert (info_cache_users,
+                             g_strdup (priv->info_cache_key),
+                             GUINT_TO_POINTER (users - 1));
+    else
+    {
+        g_hash_table_remove (info_cache_users, priv->info_cache_key);
+        if (info_cache != NULL)
+            g_hash_table_remove (info_cache, priv->info_cache_key);
+    }
+
+    g_free (priv->info_cache_key);
+    priv->info_cache_key = NULL;
+}
+
+/* the identity is counted under its current key, which changes when a new
+ * identity gets stored */
+static void
+identity_info_cache_use_locked (SignonIdentityPrivate *priv)
+{
+    guint users;
+    gchar *key;
+
+    key = identity_key (priv->id, priv->app_ctx);
+    if (g_strcmp0 (key, priv->info_cache_key) == 0)
+    {
+        g_free (key);
+        return;
+    }
+
+    identity_info_cache_unuse_locked (priv);
+
+    if (info_cache_users == NULL)
+        info_cache_users = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  g_free, NULL);
+    users = GPOINTER_TO_UINT (g_hash_table_lookup (info_cache_users, key));
+    g_hash_table_insert (info_cache_users, g_strdup (key),
+                         GUINT_TO_POINTER (users + 1));
+    priv->info_cache_key = key;
+}
+
+static SignonIdentityInfo *
+identity_info_cache_lookup (SignonIdentity *self)
+{
+    SignonIdentityPrivate *priv = self->priv;
+    SignonIdentityInfo *info;
+    GVariant *data = NULL;
+
+    g_mutex_lock (&info_cache_mutex);
+    identity_info_cache_use_locked (priv);
+    if (info_cache != NULL)
+        data = g_hash_table_lookup (info_cache, priv->info_cache_key);
+    if (data != NULL)
+        g_variant_ref (data);
+    g_mutex_unlock (&info_cache_mutex);
+
+    if (data == NULL)
+        return NULL;
+
+    info = signon_identity_info_new_from_variant (data);
+    g_variant_unref (data);
+    return info;
+}
+
+static gboolean
+identity_info_cache_unused (gpointer key, gpointer value, gpointer user_data)
+{
+    (void)value;
+    (void)user_data;
+    return g_hash_table_lookup (info_cache_users, key) == NULL;
+}
+
+static void
+identity_info_cache_store (SignonIdentity *self, GVariant *data,
+                           guint generation)
+{
+    SignonIdentityPrivate *priv = self->priv;
+
+    g_mutex_lock (&info_cache_mutex);
+    identity_info_cache_use_locked (priv);
+    if (generation == info_cache_generation)
+    {
+        if (info_cache == NULL)
+            info_cache =
+                g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                       (GDestroyNotify)g_variant_unref);
+        if (g_hash_table_size (info_cache) >= IDENTITY_INFO_CACHE_SIZE)
+            g_hash_table_foreach_remove (info_cache,
+                                         identity_info_cache_unused, NULL);
+        g_hash_table_replace (info_cache,
+                              g_strdup (priv->info_cache_key),
+                              g_variant_ref (data));
+    }
+    g_mutex_unlock (&info_cache_mutex);
+}
+
+/* Called by an identity going away: its entry goes too if it was the last
+ * user */
+static void
+identity_info_cache_release (SignonIdentity *self)
+{
+    g_mutex_lock (&info_cache_mutex);
+    identity_info_cache_unuse_locked (self->priv);
+    g_mutex_unlock (&info_cache_mutex);
+}
+
+static gboolean
+identity_info_cache_match_id (gpointer key, gpointer value,
+                              gpointer user_data)
+{
+    guint32 id;
+
+    (void)key;
+    return g_variant_lookup ((GVariant *)value, SIGNOND_IDENTITY_INFO_ID,
+                             "u", &id) &&
+        id == GPOINTER_TO_UINT (user_data);
+}
+
+static void
+identity_info_cache_invalidate (guint32 id)
+{
+    g_mutex_lock (&info_cache_mutex);
+    info_cache_generation++;
+    if (info_cache != NULL)
+        g_hash_table_foreach_remove (info_cache,
+                                     identity_info_cache_match_id,
+                                     GUINT_TO_POINTER (id));
+    g_mutex_unlock (&info_cache_mutex);
+}
+
+/*
+ * Answers of queryAvailableMechanisms for the sessions of this identity,
+ * keyed by method and wanted mechanisms. They depend on the methods
+ * stored in the identity, so they are dropped whenever its data changes;
+ * mechanisms_serial tells the sessions whether an answer they get was
+ * requested before that.
+ */
+static gchar *
+identity_mechanisms_key (const gchar *method,
+                         const gchar * const *wanted_mechanisms)
+{
+    gchar *wanted;
+    gchar *key;
+
+    wanted = wanted_mechanisms != NULL ?
+        g_strjoinv (",", (gchar **)wanted_mechanisms) : NULL;
+    key = g_strconcat (method, "\n", wanted, NULL);
+    g_free (wanted);
+
+    return key;
+}
+
+static void
+identity_mechanisms_cache_invalidate (SignonIdentity *self)
+{
+    self->priv->mechanisms_serial++;
+    g_hash_table_remove_all (self->priv->mechanisms_cache);
+}
+
+guint
+_signon_identity_get_mechanisms_serial (SignonIdentity *self)
+{
+    g_return_val_if_fail (SIGNON_IS_IDENTITY (self), 0);
+
+    return self->priv->mechanisms_serial;
+}
+
+gchar **
+_signon_identity_lookup_mechanisms (SignonIdentity *self,
+                                    const gchar *method,
+                                    const gchar * const *wanted_mechanisms)
+{
+    gchar **mechanisms;
+    gchar *key;
+
+    g_return_val_if_fail (SIGNON_IS_IDENTITY (self), NULL);
+    g_return_val_if_fail (method != NULL, NULL);
+
+    key = identity_mechanisms_key (method, wanted_mechanisms);
+    mechanisms = g_strdupv (g_hash_table_lookup (self->priv->mechanisms_cache,
+                                                 key));
+    g_free (key);
+
+    return mechanisms;
+}
+
+void
+_signon_identity_store_mechanisms (SignonIdentity *self,
+                                   guint serial,
+                                   const gchar *method,
+                                   const gchar * const *wanted_mechanisms,
+                                   gchar **mechanisms)
+{
+    g_return_if_fail (SIGNON_IS_IDENTITY (self));
+    g_return_if_fail (method != NULL);
+
+    if (serial != self->priv->mechanisms_serial || mechanisms == NULL)
+        return;
+
+    g_hash_table_replace (self->priv->mechanisms_cache,
+                          identity_mechanisms_key (method, wanted_mechanisms),
+                          g_strdupv (mechanisms));
+}
+
+/*
+ * Replies of process requests made by the sessions of this identity which
+ * have the result cache enabled, keyed by method, mechanism and session
+ * data. A reply is kept until the lifetime it declares in the
+ * IDENTITY_RESULT_EXPIRES_IN field, capped by the session's limit, or until
+ * the identity is updated or signed out.
+ */
+#define IDENTITY_RESULT_EXPIRES_IN "ExpiresIn"
+#define IDENTITY_RESULTS_CACHE_SIZE 64
+
+static void
+identity_cached_result_free (IdentityCachedResult *result)
+{
+    g_variant_unref (result->reply);
+    g_slice_free (IdentityCachedResult, result);
+}
+
+static gint
+identity_results_key_compare (gconstpointer a, gconstpointer b)
+{
+    return g_strcmp0 (*(const gchar **)a, *(const gchar **)b);
+}
+
+static gchar *
+identity_results_key (const gchar *method,
+                      const gchar *mechanism,
+                      GVariant *session_data)
+{
+    GPtrArray *entries;
+    GVariantIter iter;
+    const gchar *key;
+    GVariant *value;
+    GString *str;
+    guint i;
+
+    /* The order of the dictionary entries does not matter */
+    entries = g_ptr_array_new_with_free_func (g_free);
+    g_variant_iter_init (&iter, session_data);
+    while (g_variant_iter_next (&iter, "{&sv}", &key, &value))
+    {
+        gchar *printed = g_variant_print (value, TRUE);
+        g_ptr_array_add (entries, g_strconcat (key, "=", printed, NULL));
+        g_free (printed);
+        g_variant_unref (value);
+    }
+    g_ptr_array_sort (entries, identity_results_key_compare);
+
+    str = g_string_new (method);
+    g_string_append_c (str, '\n');
+    if (mechanism != NULL)
+        g_string_append (str, mechanism);
+    for (i = 0; i < entries->len; i++)
+    {
+        g_string_append_c (str, '\n');
+        g_string_append (str, g_ptr_array_index (entries, i));
+    }
+    g_ptr_array_unref (entries);
+
+    return g_string_free (str, FALSE);
+}
+
+static gboolean
+identity_cached_result_expired (gpointer key, gpointer value,
+                                gpointer user_data)
+{
+    IdentityCachedResult *result = value;
+
+    return result->expires <= *(gint64 *)user_data;
+}
+
+static void
+identity_results_cache_invalidate (SignonIdentity *self)
+{
+    self->priv->results_serial++;
+    g_hash_table_remove_all (self->priv->results_cache);
+}
+
+guint
+_signon_identity_get_results_serial (SignonIdentity *self)
+{
+    g_return_val_if_fail (SIGNON_IS_IDENTITY (self), 0);
+
+    return self->priv->results_serial;
+}
+
+GVariant *
+_signon_identity_lookup_result (SignonIdentity *self,
+                                const gchar *method,
+                                const gchar *mechanism,
+                                GVariant *session_data)
+{
+    IdentityCachedResult *result;
+    gchar *key;
+    GVariant *reply = NULL;
+
+    g_return_val_if_fail (SIGNON_IS_IDENTITY (self), NULL);
+
+    if (self->priv->id == 0 || g_hash_table_size (self->priv->results_cache) == 0)
+        return NULL;
+
+    key = identity_results_key (method, mechanism, session_data);
+    result = g_hash_table_lookup (self->priv->results_cache, key);
+    if (result != NULL)
+    {
+        if (result->expires > g_get_monotonic_time ())
+            reply = g_variant_ref (result->reply);
+        else
+            g_hash_table_remove (self->priv->results_cache, key);
+    }
+    g_free (key);
+
+    return reply;
+}
+
+void
+_signon_identity_store_result (SignonIdentity *self,
+                               guint serial,
+                               const gchar *method,
+                               const gchar *mechanism,
+                               GVariant *session_data,
+                               GVariant *reply,
+                               guint max_lifetime)
+{
+    IdentityCachedResult *result;
+    GVariant *v_expires;
+    gint64 lifetime = max_lifetime;
+    gint64 now;
+
+    g_return_if_fail (SIGNON_IS_IDENTITY (self));
+    g_return_if_fail (reply != NULL);
+
+    if (serial != self->priv->results_serial || self->priv->id == 0)
+        return;
+
+    v_expires = g_variant_lookup_value (reply, IDENTITY_RESULT_EXPIRES_IN,
+                                        NULL);
+    if (v_expires != NULL)
+    {
+        if (g_variant_is_of_type (v_expires, G_VARIANT_TYPE_INT32))
+            lifetime = MIN (lifetime, g_variant_get_int32 (v_expires));
+        else if (g_variant_is_of_type (v_expires, G_VARIANT_TYPE_UINT32))
+            lifetime = MIN (lifetime, g_variant_get_uint32 (v_expires));
+        else if (g_variant_is_of_type (v_expires, G_VARIANT_TYPE_INT64))
+            lifetime = MIN (lifetime, g_variant_get_int64 (v_expires));
+        else if (g_variant_is_of_type (v_expires, G_VARIANT_TYPE_UINT64))
+            lifetime = MIN ((guint64)lifetime, g_variant_get_uint64 (v_expires));
+        g_variant_unref (v_expires);
+    }
+
+    if (lifetime <= 0)
+        return;
+
+    now = g_get_monotonic_time ();
+    if (g_hash_table_size (self->priv->results_cache) >=
+        IDENTITY_RESULTS_CACHE_SIZE)
+    {
+        g_hash_table_foreach_remove (self->priv->results_cache,
+                                     identity_cached_result_expired, &now);
+        if (g_hash_table_size (self->priv->results_cache) >=
+            IDENTITY_RESULTS_CACHE_SIZE)
+            g_hash_table_remove_all (self->priv->results_cache);
+    }
+
+    result = g_slice_new (IdentityCachedResult);
+    result->reply = g_variant_ref (reply);
+    result->expires = now + lifetime * G_USEC_PER_SEC;
+    g_hash_table_replace (self->priv->results_cache,
+                          identity_results_key (method, mechanism,
+                                                session_data),
+                          result);
+}
+
+/*
+ * Process requests in flight for the sessions of this identity which share
+ * identical requests, keyed like the results cache. Each entry holds the
+ * list of the GSimpleAsyncResult of the requests waiting for the one which
+ * was sent to the daemon.
+ */
+gboolean
+_signon_identity_join_request (SignonIdentity *self,
+                               const gchar *method,
+                               const gchar *mechanism,
+                               GVariant *session_data,
+                               GSimpleAsyncResult *res,
+                               gchar **key)
+{
+    gpointer orig_key;
+    gpointer waiters;
+    gchar *request_key;
+
+    g_return_val_if_fail (SIGNON_IS_IDENTITY (self), FALSE);
+    g_return_val_if_fail (key != NULL, FALSE);
+
+    request_key = identity_results_key (method, mechanism, session_data);
+    if (g_hash_table_lookup_extended (self->priv->shared_requests,
+                                      request_key, &orig_key, &waiters))
+    {
+        DEBUG ("%s: joining request in flight", G_STRFUNC);
+        waiters = g_slist_prepend (waiters, g_object_ref (res));
+        g_hash_table_insert (self->priv->shared_requests,
+                             request_key, waiters);
+        *key = NULL;
+        return TRUE;
+    }
+
+    g_hash_table_insert (self->priv->shared_requests, request_key, NULL);
+    *key = g_strdup (request_key);
+    return FALSE;
+}
+
+void
+_signon_identity_release_request (SignonIdentity *self,
+                                  const gchar *key,
+                                  GVariant *reply,
+                                  const GError *error)
+{
+    gpointer orig_key;
+    gpointer waiters;
+    GSList *list;
+
+    g_return_if_fail (SIGNON_IS_IDENTITY (self));
+    g_return_if_fail (key != NULL);
+
+    if (!g_hash_table_lookup_extended (self->priv->shared_requests,
+                                       key, &orig_key, &waiters))
+        return;
+
+    g_hash_table_steal (self->priv->shared_requests, key);
+    g_free (orig_key);
+
+    /* The waiters were prepended */
+    waiters = g_slist_reverse (waiters);
+    for (list = waiters; list != NULL; list = list->next)
+    {
+        GSimpleAsyncResult *res = list->data;
+
+        if (error != NULL)
+            g_simple_async_result_set_from_error (res, error);
+        else
+            g_simple_async_result_set_op_res_gpointer (res,
+                                                       g_variant_ref (reply),
+                                                       (GDestroyNotify)
+                                                       g_variant_unref);
+        g_simple_async_result_complete_in_idle (res);
+        g_object_unref (res);
+    }
+    g_slist_free (waiters);
+}
+
+GSimpleAsyncResult *
+_signon_identity_hand_over_request (SignonIdentity *self,
+                                    const gchar *key,
+                                    gpointer owner,
+                                    const GError *error)
+{
+    gpointer orig_key;
+    gpointer waiters;
+    GSList *remaining = NULL;
+    GSList *list;
+    GSimpleAsyncResult *leader = NULL;
+
+    g_return_val_if_fail (SIGNON_IS_IDENTITY (self), NULL);
+    g_return_val_if_fail (key != NULL, NULL);
+
+    if (!g_hash_table_lookup_extended (self->priv->shared_requests,
+                                       key, &orig_key, &waiters))
+        return NULL;
+
+    /* The waiters made on the owner session share its fate; the oldest of
+     * the others takes over the request */
+    waiters = g_slist_reverse (waiters);
+    for (list = waiters; list != NULL; list = list->next)
+    {
+        GSimpleAsyncResult *res = list->data;
+        GObject *source;
+
+        source = g_async_result_get_source_object ((GAsyncResult *)res);
+        if (source == owner)
+        {
+            g_simple_async_result_set_from_error (res, error);
+            g_simple_async_result_complete_in_idle (res);
+            g_object_unref (res);
+        }
+        else if (leader == NULL)
+            leader = res;
+        else
+            remaining = g_slist_prepend (remaining, res);
+        g_object_unref (source);
+    }
+    g_slist_free (waiters);
+
+    if (leader == NULL)
+        g_hash_table_remove (self->priv->shared_requests, key);
+    else
+        g_hash_table_insert (self->priv->shared_requests,
+                             g_strdup (key), remaining);
+
+    return leader;
+}
+
 static void
 identity_state_changed_cb (GDBusProxy *proxy,
                            gint state,
@@ -504,33 +1122,172 @@ identity_state_changed_cb (GDBusProxy *proxy,
 }
 
 static void
-identity_remote_object_destroyed_cb(GDBusProxy *proxy,
-                                    gpointer user_data)
+identity_drop_remote_object (SignonIdentity *self)
 {
-    g_return_if_fail (SIGNON_IS_IDENTITY (user_data));
-    SignonIdentity *self = SIGNON_IDENTITY (user_data);
-
     SignonIdentityPrivate *priv = self->priv;
-    g_return_if_fail (priv != NULL);
 
     if (priv->proxy)
     {
+        sso_auth_service_unwatch_object (priv->signal_watch);
+        priv->signal_watch = NULL;
         g_object_unref (priv->proxy);
         priv->proxy = NULL;
     }
 
     DEBUG ("%s %d", G_STRFUNC, __LINE__);
 
-    _signon_object_not_ready(self);
+    _signon_object_not_ready (&priv->ready_state);
 
     priv->registration_state = NOT_REGISTERED;
+    identity_mechanisms_cache_invalidate (self);
+    identity_results_cache_invalidate (self);
+
+    signon_identity_info_free (priv->identity_info);
+    priv->identity_info = NULL;
+
+    priv->removed = FALSE;
+    priv->signed_out = FALSE;
+    priv->updated = FALSE;
+}
+
+static void
+identity_remote_object_destroyed_cb(GDBusProxy *proxy,
+                                    gpointer user_data)
+{
+    g_return_if_fail (SIGNON_IS_IDENTITY (user_data));
+    SignonIdentity *self = SIGNON_IDENTITY (user_data);
+
+    g_return_if_fail (self->priv != NULL);
+
+    identity_drop_remote_object (self);
+}
+
+static void
+identity_signal_cb (GDBusProxy *proxy, const gchar *signal_name,
+                    GVariant *parameters, gpointer user_data)
+{
+    if (g_strcmp0 (signal_name, "infoUpdated") == 0 &&
+        g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(i)")))
+    {
+        gint state;
+
+        g_variant_get (parameters, "(i)", &state);
+        identity_state_changed_cb (proxy, state, user_data);
+    }
+    else if (g_strcmp0 (signal_name, "unregistered") == 0)
+    {
+        identity_remote_object_destroyed_cb (proxy, user_data);
+    }
+}
+
+static void
+identity_disconnected (gpointer user_data)
+{
+    SignonIdentity *self = SIGNON_IDENTITY (user_data);
+    SignonIdentityPrivate *priv = self->priv;
+
+    g_clear_object (&priv->auth_service_proxy);
+
+    /* A registration still in flight notices the new connection generation
+     * when its reply comes, and starts over */
+    if (priv->registration_state != REGISTERED)
+        return;
+
+    DEBUG ("%s: re-registering identity %u", G_STRFUNC, priv->id);
+    identity_drop_remote_object (self);
+
+    /* Stored identities are registered again right away, so that they are
+     * ready by the time they are used; new ones are registered on demand */
+    if (priv->id != 0)
+        identity_check_remote_registration (self);
+}
+
+/*
+ * Returns TRUE, and starts the registration again, if the connection to
+ * signond was lost since the registration in flight was started: its reply
+ * refers to the old connection.
+ */
+static gboolean
+identity_registration_restart_if_stale (SignonIdentity *identity,
+                                        const GError *error)
+{
+    SignonIdentityPrivate *priv = identity->priv;
+
+    /* A successful reply needs the connection it was received on */
+    if (priv->registration_generation == sso_auth_service_get_generation () &&
+        (error != NULL || priv->auth_service_proxy != NULL))
+        return FALSE;
+
+    DEBUG ("%s: connection lost during registration, restarting", G_STRFUNC);
+    priv->registration_state = NOT_REGISTERED;
+    identity_check_remote_registration (identity);
+    return TRUE;
+}
+
+static void
+identity_registration_complete (SignonIdentity *identity, const GError *error)
+{
+    /*
+     * execute queued operations or emit errors on each of them
+     * */
+    identity->priv->registration_state = REGISTERED;
+
+    /*
+     * TODO: if we will add a new state for identity: "INVALID"
+     * consider emission of another error, like "invalid"
+     * */
+    _signon_object_ready (identity, &identity->priv->ready_state, error);
+
+    /*
+     * as the registration failed we do not
+     * request for new registration, but emit
+     * same error again and again
+     * */
+}
+
+static void
+identity_proxy_new_cb (GObject *object, GAsyncResult *res,
+                       gpointer userdata)
+{
+    SignonIdentity *identity = (SignonIdentity*)userdata;
+    SignonIdentityPrivate *priv;
+    SsoIdentity *proxy;
+    GError *error = NULL;
+
+    (void)object;
+
+    proxy = sso_identity_proxy_new_finish (res, &error);
+    if (!SIGNON_IS_NOT_CANCELLED (error))
+    {
+        g_clear_error (&error);
+        return;
+    }
+
+    priv = identity->priv;
+    if (identity_registration_restart_if_stale (identity, error))
+    {
+        if (proxy != NULL)
+            g_object_unref (proxy);
+        g_clear_error (&error);
+        return;
+    }
 
-    signon_identity_info_free (priv->identity_info);
-    priv->identity_info = NULL;
+    if (G_LIKELY (error == NULL))
+    {
+        priv->proxy = proxy;
+        priv->signal_watch =
+            sso_auth_service_watch_object ((GDBusProxy *)priv->proxy,
+                                           identity_signal_cb,
+                                           identity);
+    }
+    else
+    {
+        g_warning ("Failed to initialize Identity proxy: %s",
+                   error->message);
+    }
 
-    priv->removed = FALSE;
-    priv->signed_out = FALSE;
-    priv->updated = FALSE;
+    identity_registration_complete (identity, error);
+    g_clear_error (&error);
 }
 
 static void
@@ -545,12 +1302,18 @@ identity_registered (SignonIdentity *identity,
 
     g_return_if_fail (priv != NULL);
 
+    if (identity_registration_restart_if_stale (identity, error))
+    {
+        if (identity_data)
+            g_variant_unref (identity_data);
+        return;
+    }
+
     if (!error)
     {
         GDBusConnection *connection;
         GDBusProxy *auth_service_proxy;
         const gchar *bus_name;
-        GError *proxy_error = NULL;
 
         DEBUG("%s: %s", G_STRFUNC, object_path);
         /*
@@ -559,65 +1322,38 @@ identity_registered (SignonIdentity *identity,
          * */
         g_return_if_fail (priv->proxy == NULL);
 
-        auth_service_proxy = (GDBusProxy *)priv->auth_service_proxy;
-        connection = g_dbus_proxy_get_connection (auth_service_proxy);
-        bus_name = g_dbus_proxy_get_name (auth_service_proxy);
-
-        priv->proxy =
-            sso_identity_proxy_new_sync (connection,
-                                         G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
-                                         bus_name,
-                                         object_path,
-                                         priv->cancellable,
-                                         &proxy_error);
-        if (G_UNLIKELY (proxy_error != NULL))
-        {
-            g_warning ("Failed to initialize Identity proxy: %s",
-                       proxy_error->message);
-            g_clear_error (&proxy_error);
-        }
-
-        priv->signal_info_updated =
-            g_signal_connect (priv->proxy,
-                              "info-updated",
-                              G_CALLBACK (identity_state_changed_cb),
-                              identity);
-
-        priv->signal_unregistered =
-            g_signal_connect (priv->proxy,
-                              "unregistered",
-                              G_CALLBACK (identity_remote_object_destroyed_cb),
-                              identity);
-
         if (identity_data)
         {
             DEBUG("%s: ", G_STRFUNC);
+            signon_identity_info_free (priv->identity_info);
             priv->identity_info =
                 signon_identity_info_new_from_variant (identity_data);
+
+            identity_info_cache_store (identity, identity_data,
+                                       priv->info_generation);
             g_variant_unref (identity_data);
         }
 
         priv->updated = TRUE;
-    }
-    else
-        g_warning ("%s: %s", G_STRFUNC, error->message);
 
-    /*
-     * execute queued operations or emit errors on each of them
-     * */
-    priv->registration_state = REGISTERED;
+        /* The queued operations are released once the proxy is set up */
+        auth_service_proxy = (GDBusProxy *)priv->auth_service_proxy;
+        connection = g_dbus_proxy_get_connection (auth_service_proxy);
+        bus_name = g_dbus_proxy_get_name (auth_service_proxy);
 
-    /*
-     * TODO: if we will add a new state for identity: "INVALID"
-     * consider emission of another error, like "invalid"
-     * */
-    _signon_object_ready (identity, identity_object_quark (), error);
+        sso_identity_proxy_new (connection,
+                                G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                                G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                                bus_name,
+                                object_path,
+                                priv->cancellable,
+                                identity_proxy_new_cb,
+                                identity);
+        return;
+    }
 
-    /*
-     * as the registration failed we do not
-     * request for new registration, but emit
-     * same error again and again
-     * */
+    g_warning ("%s: %s", G_STRFUNC, error->message);
+    identity_registration_complete (identity, error);
 }
 
 /**
@@ -632,7 +1368,7 @@ const GError *
 signon_identity_get_last_error (SignonIdentity *identity)
 {
     g_return_val_if_fail (SIGNON_IS_IDENTITY (identity), NULL);
-    return _signon_object_last_error(identity);
+    return _signon_object_last_error (&identity->priv->ready_state);
 }
 
 static void
@@ -686,15 +1422,11 @@ identity_new_from_db_cb (GObject *object, GAsyncResult *res,
 }
 
 static void
-identity_check_remote_registration (SignonIdentity *self)
+identity_register_remote (SignonIdentity *self)
 {
-    g_return_if_fail (self != NULL);
     SignonIdentityPrivate *priv = self->priv;
 
-    g_return_if_fail (priv != NULL);
-
-    if (priv->registration_state != NOT_REGISTERED)
-        return;
+    priv->info_generation = identity_info_cache_generation ();
 
     if (priv->id != 0)
         sso_auth_service_call_get_identity (priv->auth_service_proxy,
@@ -709,8 +1441,141 @@ identity_check_remote_registration (SignonIdentity *self)
                                                      priv->cancellable,
                                                      identity_new_cb,
                                                      self);
+}
+
+static void
+identity_auth_service_ready_cb (GObject *object, GAsyncResult *res,
+                                gpointer userdata)
+{
+    SignonIdentity *identity = (SignonIdentity*)userdata;
+    SsoAuthService *auth_service_proxy;
+    GError *error = NULL;
+
+    (void)object;
+    DEBUG ("%s", G_STRFUNC);
+
+    auth_service_proxy = sso_auth_service_get_instance_finish (res, &error);
+    if (!SIGNON_IS_NOT_CANCELLED (error))
+    {
+        g_clear_error (&error);
+        return;
+    }
+
+    if (error == NULL)
+    {
+        identity->priv->auth_service_proxy = auth_service_proxy;
+        identity_register_remote (identity);
+    }
+    else
+    {
+        identity_registered (identity, NULL, NULL, error);
+        g_clear_error (&error);
+    }
+}
+
+static void
+identity_check_remote_registration (SignonIdentity *self)
+{
+    g_return_if_fail (self != NULL);
+    SignonIdentityPrivate *priv = self->priv;
+
+    g_return_if_fail (priv != NULL);
+
+    if (priv->registration_state != NOT_REGISTERED)
+        return;
 
     priv->registration_state = PENDING_REGISTRATION;
+    priv->registration_generation = sso_auth_service_get_generation ();
+
+    /* The connection to signond is set up asynchronously the first time it
+     * is needed; until then the operations stay in the ready queue */
+    if (priv->auth_service_proxy == NULL)
+        sso_auth_service_get_instance_async (priv->cancellable,
+                                             identity_auth_service_ready_cb,
+                                             self);
+    else
+        identity_register_remote (self);
+}
+
+/*
+ * Identities resolved ahead of time by signon_auth_service_prewarm(), kept
+ * per thread (their proxies are bound to the thread-default main context)
+ * until the application asks for them.
+ */
+static GPrivate identity_pool = G_PRIVATE_INIT ((GDestroyNotify)g_hash_table_unref);
+
+static SignonIdentity *
+identity_pool_steal (guint32 id, const gchar *application_context)
+{
+    GHashTable *pool;
+    SignonIdentity *identity = NULL;
+    gchar *pool_key;
+    gchar *key;
+
+    pool = g_private_get (&identity_pool);
+    if (G_LIKELY (pool == NULL))
+        return NULL;
+
+    key = identity_key (id, application_context);
+    if (g_hash_table_lookup_extended (pool, key, (gpointer *)&pool_key,
+                                      (gpointer *)&identity))
+    {
+        /* stealing doesn't free the key */
+        g_hash_table_steal (pool, key);
+        g_free (pool_key);
+    }
+    g_free (key);
+
+    if (identity != NULL && identity->priv->removed)
+    {
+        g_object_unref (identity);
+        identity = NULL;
+    }
+
+    return identity;
+}
+
+void
+_signon_identity_prewarm (guint32 id, const gchar *application_context)
+{
+    GHashTable *pool;
+    SignonIdentity *identity;
+    gchar *key;
+
+    g_return_if_fail (id != 0);
+
+    pool = g_private_get (&identity_pool);
+    if (pool == NULL)
+    {
+        pool = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                      g_free, g_object_unref);
+        g_private_set (&identity_pool, pool);
+    }
+
+    key = identity_key (id, application_context);
+    if (g_hash_table_lookup (pool, key) != NULL)
+    {
+        g_free (key);
+        return;
+    }
+
+    identity = signon_identity_new_with_context_from_db (id,
+                                                         application_context);
+    g_hash_table_insert (pool, key, identity);
+}
+
+void
+_signon_identity_call_when_ready (SignonIdentity *self,
+                                  SignonReadyCb callback,
+                                  gpointer user_data)
+{
+    g_return_if_fail (SIGNON_IS_IDENTITY (self));
+
+    identity_check_remote_registration (self);
+    _signon_object_call_when_ready (self,
+                                    &self->priv->ready_state,
+                                    callback,
+                                    user_data);
 }
 
 /**
@@ -762,6 +1627,10 @@ signon_identity_new_with_context_from_db (guint32 id, const gchar *application_c
     if (id == 0)
         return NULL;
 
+    identity = identity_pool_steal (id, application_context);
+    if (identity != NULL)
+        return identity;
+
     identity = g_object_new (SIGNON_TYPE_IDENTITY,
                              "id", id,
                              "app_ctx", application_context,
@@ -777,6 +1646,128 @@ signon_identity_new_with_context_from_db (guint32 id, const gchar *application_c
     return identity;
 }
 
+/*
+ * Identities handed out by signon_identity_get_with_context_from_db(), kept
+ * per thread by weak reference so that they go away as soon as the
+ * application drops them. The entries left behind are pruned whenever a
+ * new identity is added.
+ */
+static void
+identity_registry_entry_free (GWeakRef *ref)
+{
+    g_weak_ref_clear (ref);
+    g_slice_free (GWeakRef, ref);
+}
+
+static gboolean
+identity_registry_entry_is_dead (gpointer key, gpointer value,
+                                 gpointer user_data)
+{
+    GObject *object = g_weak_ref_get ((GWeakRef *)value);
+
+    (void)key;
+    (void)user_data;
+    if (object == NULL)
+        return TRUE;
+    g_object_unref (object);
+    return FALSE;
+}
+
+static GPrivate identity_registry =
+    G_PRIVATE_INIT ((GDestroyNotify)g_hash_table_unref);
+
+/**
+ * signon_identity_get_from_db:
+ * @id: identity ID.
+ *
+ * Get an identity object associated with an existing identity record,
+ * sharing it with the other callers of this function.
+ * This is essentially equivalent to calling
+ * signon_identity_get_with_context_from_db() and passing %NULL as the
+ * application context.
+ *
+ * Returns: (transfer full): an instance of a #SignonIdentity.
+ */
+SignonIdentity *
+signon_identity_get_from_db (guint32 id)
+{
+    return signon_identity_get_with_context_from_db (id, NULL);
+}
+
+/**
+ * signon_identity_get_with_context_from_db:
+ * @id: identity ID.
+ * @application_context: application security context, can be %NULL.
+ *
+ * Get an identity object associated with an existing identity record.
+ * Unlike signon_identity_new_with_context_from_db(), if the calling thread
+ * already holds a live identity object for the same @id and
+ * @application_context which was obtained through this function, a new
+ * reference to that object is returned instead of creating another one,
+ * so no further communication with the gSSO daemon is needed.
+ *
+ * Since the object is shared, any change made through it (for instance
+ * with signon_identity_store_credentials_with_info()) is visible to all
+ * of its holders.
+ *
+ * Returns: (transfer full): an instance of a #SignonIdentity.
+ */
+SignonIdentity *
+signon_identity_get_with_context_from_db (guint32 id,
+                                          const gchar *application_context)
+{
+    GHashTable *registry;
+    SignonIdentity *identity;
+    GWeakRef *ref;
+    gchar *key;
+
+    if (id == 0)
+        return NULL;
+
+    registry = g_private_get (&identity_registry);
+    if (registry == NULL)
+    {
+        registry = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          (GDestroyNotify)identity_registry_entry_free);
+        g_private_set (&identity_registry, registry);
+    }
+
+    key = identity_key (id, application_context);
+
+    ref = g_hash_table_lookup (registry, key);
+    if (ref != NULL)
+    {
+        identity = g_weak_ref_get (ref);
+        if (identity != NULL)
+        {
+            if (!identity->priv->removed)
+            {
+                DEBUG ("%s: reusing identity %u", G_STRFUNC, id);
+                g_free (key);
+                return identity;
+            }
+            g_object_unref (identity);
+        }
+    }
+
+    identity = signon_identity_new_with_context_from_db (id,
+                                                         application_context);
+    if (identity == NULL)
+    {
+        g_free (key);
+        return NULL;
+    }
+
+    g_hash_table_foreach_remove (registry, identity_registry_entry_is_dead,
+                                 NULL);
+
+    ref = g_slice_new (GWeakRef);
+    g_weak_ref_init (ref, identity);
+    g_hash_table_replace (registry, key, ref);
+
+    return identity;
+}
+
 /**
  * signon_identity_new:
  *
@@ -830,7 +1821,8 @@ signon_identity_new_with_context (const gchar *application_context)
  * Creates an authentication session for this identity. If the identity has been
  * retrieved from the database, the authentication method must be one of those 
  * listed in signon_identity_info_get_methods(), otherwise it can be any method
- * supported by gSSO.
+ * supported by gSSO. The number of sessions which can exist at the same time
+ * for one method is limited by signon_identity_set_max_sessions_per_method().
  *
  * Returns: (transfer full): a new #SignonAuthSession.
  */
@@ -856,22 +1848,17 @@ signon_identity_create_session(SignonIdentity *self,
         return NULL;
     }
 
-    GSList *list = priv->sessions;
-    while (list)
+    guint count = GPOINTER_TO_UINT (g_hash_table_lookup (priv->session_counts,
+                                                         method));
+    if (priv->max_sessions_per_method != 0 &&
+        count >= priv->max_sessions_per_method)
     {
-        SignonAuthSession *session = SIGNON_AUTH_SESSION (priv->sessions->data);
-        const gchar *sessionMethod = signon_auth_session_get_method (session);
-        if (g_strcmp0(sessionMethod, method) == 0)
-        {
-            DEBUG ("Auth Session with method `%s` already created.", method);
-            g_set_error (error,
-                         signon_error_quark(),
-                         SIGNON_ERROR_METHOD_NOT_AVAILABLE,
-                         "Authentication session for this method already requested.");
-            return NULL;
-        }
-
-        list = list->next;
+        DEBUG ("Auth Session with method `%s` already created.", method);
+        g_set_error (error,
+                     signon_error_quark(),
+                     SIGNON_ERROR_METHOD_NOT_AVAILABLE,
+                     "Authentication session for this method already requested.");
+        return NULL;
     }
 
     SignonAuthSession *session =
@@ -880,11 +1867,19 @@ signon_identity_create_session(SignonIdentity *self,
                                               error);
     if (session)
     {
+        IdentitySessionLink *link;
+
         DEBUG ("%s %d - success", G_STRFUNC, __LINE__);
-        priv->sessions = g_slist_append(priv->sessions, session);
+        priv->sessions = g_slist_prepend (priv->sessions, session);
+        g_hash_table_replace (priv->session_counts, g_strdup (method),
+                              GUINT_TO_POINTER (count + 1));
+
+        link = g_slice_new (IdentitySessionLink);
+        link->identity = self;
+        link->method = g_strdup (method);
         g_object_weak_ref (G_OBJECT(session),
                            identity_session_object_destroyed_cb,
-                           self);
+                           link);
         /*
          * if you want to delete the identity
          * you MUST delete all authsessions
@@ -897,6 +1892,42 @@ signon_identity_create_session(SignonIdentity *self,
     return session;
 }
 
+/**
+ * signon_identity_set_max_sessions_per_method:
+ * @self: the #SignonIdentity.
+ * @max_sessions: the maximum number of sessions, or 0 for no limit.
+ *
+ * Sets how many authentication sessions can exist at the same time for
+ * the same method on this identity; signon_identity_create_session() fails
+ * with %SIGNON_ERROR_METHOD_NOT_AVAILABLE beyond that. Each session has its
+ * own object in the gSSO daemon, so several sessions can process requests
+ * for the same method in parallel. The default is 1.
+ */
+void
+signon_identity_set_max_sessions_per_method (SignonIdentity *self,
+                                             guint max_sessions)
+{
+    g_return_if_fail (SIGNON_IS_IDENTITY (self));
+
+    self->priv->max_sessions_per_method = max_sessions;
+}
+
+/**
+ * signon_identity_get_max_sessions_per_method:
+ * @self: the #SignonIdentity.
+ *
+ * Get the limit set with signon_identity_set_max_sessions_per_method().
+ *
+ * Returns: the maximum number of sessions per method, or 0 for no limit.
+ */
+guint
+signon_identity_get_max_sessions_per_method (SignonIdentity *self)
+{
+    g_return_val_if_fail (SIGNON_IS_IDENTITY (self), 0);
+
+    return self->priv->max_sessions_per_method;
+}
+
 /**
  * signon_identity_store_credentials_with_info:
  * @self: the #SignonIdentity.
@@ -939,7 +1970,7 @@ signon_identity_store_credentials_with_info(SignonIdentity *self,
 
     identity_check_remote_registration (self);
     _signon_object_call_when_ready (self,
-                                    identity_object_quark(),
+                                    &self->priv->ready_state,
                                     identity_store_credentials_ready_cb,
                                     operation_data);
 }
@@ -1033,6 +2064,7 @@ identity_store_credentials_ready_cb (gpointer object, const GError *error, gpoin
     {
         g_return_if_fail (priv->proxy != NULL);
 
+        priv->stores_in_flight++;
         sso_identity_call_store (priv->proxy,
                                  operation_data->info_variant,
                                  priv->cancellable,
@@ -1060,12 +2092,29 @@ identity_store_credentials_reply (GObject *object, GAsyncResult *res,
 
     sso_identity_call_store_finish (proxy, &id, res, &error);
 
+    if (SIGNON_IS_NOT_CANCELLED (error) && priv->stores_in_flight > 0)
+        priv->stores_in_flight--;
+
     if (error == NULL)
     {
         g_return_if_fail (priv->identity_info == NULL);
 
+        if (priv->store_logged_by_signal)
+            priv->store_logged_by_signal = FALSE;
+        else
+        {
+            _signon_auth_service_identity_changed (priv->id == 0 ?
+                                                   SIGNON_IDENTITY_CHANGE_ADDED :
+                                                   SIGNON_IDENTITY_CHANGE_UPDATED,
+                                                   id);
+            priv->store_echo_pending = TRUE;
+        }
+
         g_object_set (cb_data->self, "id", id, NULL);
         cb_data->self->priv->id = id;
+        identity_info_cache_invalidate (id);
+        identity_mechanisms_cache_invalidate (cb_data->self);
+        identity_results_cache_invalidate (cb_data->self);
 
         /*
          * if the previous state was REMOVED
@@ -1189,7 +2238,7 @@ void signon_identity_verify_user(SignonIdentity *self,
 
     identity_check_remote_registration (self);
     _signon_object_call_when_ready (self,
-                                    identity_object_quark(),
+                                    &self->priv->ready_state,
                                     identity_verify_ready_cb,
                                     cb_data);
 }
@@ -1205,6 +2254,18 @@ identity_process_updated (SignonIdentity *self)
     SignonIdentityPrivate *priv = self->priv;
     g_return_if_fail (priv->proxy != NULL);
 
+    identity_info_cache_invalidate (priv->id);
+    if (priv->store_echo_pending)
+        priv->store_echo_pending = FALSE;
+    else if (priv->id != 0)
+    {
+        _signon_auth_service_identity_changed (SIGNON_IDENTITY_CHANGE_UPDATED,
+                                               priv->id);
+        priv->store_logged_by_signal = priv->stores_in_flight > 0;
+    }
+    identity_mechanisms_cache_invalidate (self);
+    identity_results_cache_invalidate (self);
+
     signon_identity_info_free (priv->identity_info);
     priv->identity_info = NULL;
     priv->updated = FALSE;
@@ -1226,6 +2287,12 @@ identity_process_removed (SignonIdentity *self)
         return;
 
     priv->removed = TRUE;
+    identity_info_cache_invalidate (priv->id);
+    identity_mechanisms_cache_invalidate (self);
+    identity_results_cache_invalidate (self);
+    if (priv->id != 0)
+        _signon_auth_service_identity_changed (SIGNON_IDENTITY_CHANGE_REMOVED,
+                                               priv->id);
     signon_identity_info_free (priv->identity_info);
     priv->identity_info = NULL;
 
@@ -1246,6 +2313,8 @@ identity_process_signout(SignonIdentity *self)
     if (priv->signed_out == TRUE)
         return;
 
+    identity_results_cache_invalidate (self);
+
     GSList *llink = priv->sessions;
     while (llink)
     {
@@ -1278,6 +2347,9 @@ identity_signout_reply (GObject *object, GAsyncResult *res,
 
     sso_identity_call_sign_out_finish (proxy, &result, res, &error);
 
+    if (error == NULL)
+        identity_results_cache_invalidate (cb_data->self);
+
     if (SIGNON_IS_NOT_CANCELLED (error) && cb_data->cb)
     {
         (cb_data->cb) (cb_data->self, error, cb_data->user_data);
@@ -1351,18 +2423,32 @@ identity_info_reply(GObject *object, GAsyncResult *res,
     g_return_if_fail (cb_data->self != NULL);
     g_return_if_fail (cb_data->self->priv != NULL);
 
-    SignonIdentityPrivate *priv = cb_data->self->priv;
-
     sso_identity_call_get_info_finish (proxy, &identity_data, res, &error);
 
+    if (!SIGNON_IS_NOT_CANCELLED (error))
+    {
+        /* the identity may already be gone */
+        if (identity_data != NULL)
+            g_variant_unref (identity_data);
+        g_clear_error (&error);
+        g_slice_free (IdentityInfoCbData, cb_data);
+        return;
+    }
+
+    SignonIdentityPrivate *priv = cb_data->self->priv;
+
     if (identity_data != NULL)
     {
+        signon_identity_info_free (priv->identity_info);
         priv->identity_info =
                 signon_identity_info_new_from_variant (identity_data);
+
+        identity_info_cache_store (cb_data->self, identity_data,
+                                   cb_data->info_generation);
         g_variant_unref (identity_data);
     }
 
-    if (SIGNON_IS_NOT_CANCELLED (error) && cb_data->cb)
+    if (cb_data->cb)
     {
         (cb_data->cb) (cb_data->self, priv->identity_info, error, cb_data->user_data);
     }
@@ -1417,14 +2503,30 @@ identity_info_ready_cb(gpointer object, const GError *error, gpointer user_data)
     }
     else if (priv->updated == FALSE)
     {
-        DEBUG ("%s identity needs update, call daemon", G_STRFUNC);
+        SignonIdentityInfo *cached;
 
-        g_return_if_fail (priv->proxy != NULL);
-        sso_identity_call_get_info (priv->proxy,
-                                    priv->cancellable,
-                                    identity_info_reply,
-                                    cb_data);
-        goto free_op_data;
+        cached = identity_info_cache_lookup (self);
+        if (cached == NULL)
+        {
+            DEBUG ("%s identity needs update, call daemon", G_STRFUNC);
+
+            g_return_if_fail (priv->proxy != NULL);
+            cb_data->info_generation = identity_info_cache_generation ();
+            sso_identity_call_get_info (priv->proxy,
+                                        priv->cancellable,
+                                        identity_info_reply,
+                                        cb_data);
+            goto free_op_data;
+        }
+
+        DEBUG ("%s pass cached one", G_STRFUNC);
+
+        signon_identity_info_free (priv->identity_info);
+        priv->identity_info = cached;
+        priv->updated = TRUE;
+
+        if (cb_data->cb)
+            (cb_data->cb) (self, priv->identity_info, error, cb_data->user_data);
     }
     else
     {
@@ -1599,7 +2701,7 @@ identity_void_operation(SignonIdentity *self,
     IdentityVoidData *operation_data = g_slice_new0 (IdentityVoidData);
     operation_data->cb_data = cb_data;
     _signon_object_call_when_ready (self,
-                                    identity_object_quark(),
+                                    &self->priv->ready_state,
                                     identity_info_ready_cb,
                                     operation_data);
 }
@@ -1630,7 +2732,7 @@ void signon_identity_remove(SignonIdentity *self,
 
     identity_check_remote_registration (self);
     _signon_object_call_when_ready (self,
-                                    identity_object_quark(),
+                                    &self->priv->ready_state,
                                     identity_remove_ready_cb,
                                     cb_data);
 }
@@ -1665,7 +2767,7 @@ void signon_identity_request_credentials_update(SignonIdentity *self,
 
     identity_check_remote_registration (self);
     _signon_object_call_when_ready (self,
-                                    identity_object_quark(),
+                                    &self->priv->ready_state,
                                     identity_credentials_update_ready_cb,
                                     cb_data);
 }
@@ -1696,7 +2798,7 @@ void signon_identity_signout(SignonIdentity *self,
 
     identity_check_remote_registration (self);
     _signon_object_call_when_ready (self,
-                                    identity_object_quark(),
+                                    &self->priv->ready_state,
                                     identity_signout_ready_cb,
                                     cb_data);
 }
@@ -1780,6 +2882,15 @@ void signon_identity_query_info(SignonIdentity *self,
                             cb_data);
 }
 
+static void
+identity_session_cb_data_free (IdentitySessionCbData *cb_data)
+{
+    if (cb_data->session != NULL)
+        g_object_remove_weak_pointer ((GObject *)cb_data->session,
+                                      (gpointer *)&cb_data->session);
+    g_slice_free (IdentitySessionCbData, cb_data);
+}
+
 static void
 identity_get_auth_session_reply (GObject *object, GAsyncResult *res,
                                  gpointer userdata)
@@ -1799,7 +2910,9 @@ identity_get_auth_session_reply (GObject *object, GAsyncResult *res,
     g_return_if_fail (cb_data != NULL);
     g_return_if_fail (cb_data->cb != NULL);
 
-    if (SIGNON_IS_NOT_CANCELLED (error))
+    /* The session might have been destroyed while the request was
+     * pipelined behind the identity registration */
+    if (SIGNON_IS_NOT_CANCELLED (error) && cb_data->session != NULL)
     {
         (cb_data->cb) (cb_data->session,
                 error,
@@ -1807,7 +2920,7 @@ identity_get_auth_session_reply (GObject *object, GAsyncResult *res,
                 g_dbus_proxy_get_name ((GDBusProxy *)proxy),
                 object_path);
     }
-    g_slice_free (IdentitySessionCbData, cb_data);
+    identity_session_cb_data_free (cb_data);
     if (object_path) g_free (object_path);
     g_clear_error (&error);
 }
@@ -1829,9 +2942,15 @@ identity_session_ready_cb(gpointer object, const GError *error, gpointer user_da
     g_return_if_fail (cb_data != NULL);
     g_return_if_fail (cb_data->cb != NULL);
 
-    if (error)
+    if (cb_data->session == NULL)
+    {
+        DEBUG ("%s: session destroyed", G_STRFUNC);
+        identity_session_cb_data_free (cb_data);
+    }
+    else if (error)
     {
         (cb_data->cb) (cb_data->session, (GError *)error, NULL, NULL, NULL);
+        identity_session_cb_data_free (cb_data);
     }
     else if (priv->removed == TRUE)
     {
@@ -1840,6 +2959,7 @@ identity_session_ready_cb(gpointer object, const GError *error, gpointer user_da
                                          "Already removed from database.");
         (cb_data->cb) (cb_data->session, new_error, NULL, NULL, NULL);
         g_error_free (new_error);
+        identity_session_cb_data_free (cb_data);
     }
     else
     {
@@ -1853,6 +2973,7 @@ identity_session_ready_cb(gpointer object, const GError *error, gpointer user_da
             cb_data);
     }
 
+    g_free (operation_data->method);
     g_slice_free (IdentitySessionData, operation_data);
 }
 
@@ -1860,14 +2981,30 @@ static void
 identity_session_object_destroyed_cb(gpointer data,
                                      GObject *where_the_session_was)
 {
-    g_return_if_fail (SIGNON_IS_IDENTITY (data));
+    IdentitySessionLink *link = data;
+    guint count;
+
+    g_return_if_fail (SIGNON_IS_IDENTITY (link->identity));
     DEBUG ("%s %d", G_STRFUNC, __LINE__);
 
-    SignonIdentity *self = SIGNON_IDENTITY (data);
+    SignonIdentity *self = link->identity;
     SignonIdentityPrivate *priv = self->priv;
     g_return_if_fail (priv != NULL);
 
     priv->sessions = g_slist_remove(priv->sessions, (gpointer)where_the_session_was);
+
+    count = GPOINTER_TO_UINT (g_hash_table_lookup (priv->session_counts,
+                                                   link->method));
+    if (count > 1)
+        g_hash_table_replace (priv->session_counts, link->method,
+                              GUINT_TO_POINTER (count - 1));
+    else
+    {
+        g_hash_table_remove (priv->session_counts, link->method);
+        g_free (link->method);
+    }
+    g_slice_free (IdentitySessionLink, link);
+
     g_object_unref (self);
 }
 
@@ -1896,15 +3033,17 @@ void signon_identity_get_auth_session (SignonIdentity *self,
     IdentitySessionCbData *cb_data = g_slice_new0 (IdentitySessionCbData);
     cb_data->self = self;
     cb_data->session = session;
+    g_object_add_weak_pointer ((GObject *)session,
+                               (gpointer *)&cb_data->session);
     cb_data->cb = cb;
 
     IdentitySessionData *operation_data = g_slice_new0 (IdentitySessionData);
-    operation_data->method = method;
+    operation_data->method = g_strdup (method);
     operation_data->cb_data = cb_data;
 
     identity_check_remote_registration (self);
     _signon_object_call_when_ready (self,
-                                    identity_object_quark(),
+                                    &self->priv->ready_state,
                                     identity_session_ready_cb,
                                     operation_data);
 }
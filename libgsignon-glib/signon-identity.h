@@ -117,12 +117,20 @@ SignonIdentity *signon_identity_new_with_context_from_db (guint32 id,
                                                           const gchar *application_context);
 SignonIdentity *signon_identity_new_with_context (const gchar *application_context);
 
+SignonIdentity *signon_identity_get_from_db (guint32 id);
+SignonIdentity *signon_identity_get_with_context_from_db (guint32 id,
+                                                          const gchar *application_context);
+
 const GError *signon_identity_get_last_error (SignonIdentity *identity);
 
 SignonAuthSession *signon_identity_create_session(SignonIdentity *self,
                                                   const gchar *method,
                                                   GError **error);
 
+void signon_identity_set_max_sessions_per_method (SignonIdentity *self,
+                                                  guint max_sessions);
+guint signon_identity_get_max_sessions_per_method (SignonIdentity *self);
+
 /**
  * SignonIdentityStoreCredentialsCb:
  * @self: the #SignonIdentity.
@@ -70,6 +70,19 @@
 #define SIGNOND_IDENTITY_INFO_VALIDATED             "Validated"
 #define SIGNOND_IDENTITY_INFO_USERNAME_IS_SECRET    "UserNameSecret"
 
+/*
+ * Identity query filter keys
+ * */
+#define SIGNOND_IDENTITY_FILTER_OWNER               "Owner"
+#define SIGNOND_IDENTITY_FILTER_TYPE                "Type"
+#define SIGNOND_IDENTITY_FILTER_CAPTION             "Caption"
+#define SIGNOND_IDENTITY_FILTER_ID_RANGE            "IdRange"
+#define SIGNOND_IDENTITY_FILTER_METHOD              "Method"
+#define SIGNOND_IDENTITY_FILTER_REALM               "Realm"
+#define SIGNOND_IDENTITY_FILTER_ACL_MEMBER          "ACLMember"
+#define SIGNOND_IDENTITY_FILTER_TYPE_MASK           "TypeMask"
+#define SIGNOND_IDENTITY_FILTER_FIELDS              "Fields"
+
 /*
  * Common server/client sides error names and messages
  * */
@@ -124,6 +137,9 @@
 
 
 #include "signon-identity-info.h"
+#include "signon-identity.h"
+#include "signon-auth-service.h"
+#include "signon-dbus-queue.h"
 
 G_BEGIN_DECLS
 
@@ -139,16 +155,106 @@ struct _SignonIdentityInfo
     SignonSecurityContext *owner;
     SignonSecurityContextList *access_control_list;
     gint type;
+    /* serialized data the fields flagged in pending_fields are still to be
+     * decoded from; see identity_info_ensure() */
+    GVariant *variant;
+    volatile gint pending_fields;
 };
 
 G_GNUC_INTERNAL
 SignonIdentityInfo *
 signon_identity_info_new_from_variant (GVariant *variant);
 
+G_GNUC_INTERNAL
+SignonIdentityInfo *
+signon_identity_info_new_from_variant_fields (GVariant *variant,
+                                              SignonIdentityInfoField fields);
+
+G_GNUC_INTERNAL
+GVariant *
+signon_identity_info_fields_to_variant (SignonIdentityInfoField fields);
+
 G_GNUC_INTERNAL
 GVariant *
 signon_identity_info_to_variant (const SignonIdentityInfo *self);
 
+G_GNUC_INTERNAL
+void
+_signon_identity_prewarm (guint32 id, const gchar *application_context);
+
+G_GNUC_INTERNAL
+guint
+_signon_identity_get_mechanisms_serial (SignonIdentity *self);
+
+G_GNUC_INTERNAL
+gchar **
+_signon_identity_lookup_mechanisms (SignonIdentity *self,
+                                    const gchar *method,
+                                    const gchar * const *wanted_mechanisms);
+
+G_GNUC_INTERNAL
+void
+_signon_identity_store_mechanisms (SignonIdentity *self,
+                                   guint serial,
+                                   const gchar *method,
+                                   const gchar * const *wanted_mechanisms,
+                                   gchar **mechanisms);
+
+G_GNUC_INTERNAL
+guint
+_signon_identity_get_results_serial (SignonIdentity *self);
+
+G_GNUC_INTERNAL
+GVariant *
+_signon_identity_lookup_result (SignonIdentity *self,
+                                const gchar *method,
+                                const gchar *mechanism,
+                                GVariant *session_data);
+
+G_GNUC_INTERNAL
+void
+_signon_identity_store_result (SignonIdentity *self,
+                               guint serial,
+                               const gchar *method,
+                               const gchar *mechanism,
+                               GVariant *session_data,
+                               GVariant *reply,
+                               guint max_lifetime);
+
+G_GNUC_INTERNAL
+gboolean
+_signon_identity_join_request (SignonIdentity *self,
+                               const gchar *method,
+                               const gchar *mechanism,
+                               GVariant *session_data,
+                               GSimpleAsyncResult *res,
+                               gchar **key);
+
+G_GNUC_INTERNAL
+void
+_signon_identity_release_request (SignonIdentity *self,
+                                  const gchar *key,
+                                  GVariant *reply,
+                                  const GError *error);
+
+G_GNUC_INTERNAL
+GSimpleAsyncResult *
+_signon_identity_hand_over_request (SignonIdentity *self,
+                                    const gchar *key,
+                                    gpointer owner,
+                                    const GError *error);
+
+G_GNUC_INTERNAL
+void
+_signon_auth_service_identity_changed (SignonIdentityChangeType type,
+                                       guint32 id);
+
+G_GNUC_INTERNAL
+void
+_signon_identity_call_when_ready (SignonIdentity *self,
+                                  SignonReadyCb callback,
+                                  gpointer user_data);
+
 G_END_DECLS
 
 #endif
@@ -27,119 +27,932 @@
 #include "signon-internals.h"
 #include "sso-auth-service.h"
 
+/*
+ * Signals from the remote Identity and AuthSession objects are received
+ * through a single subscription per interface, and routed to the watching
+ * objects by object path. The dispatcher belongs to the thread which set
+ * it up, where the signals are delivered, but the objects may go away in
+ * any thread: each watch keeps a reference on its dispatcher, and the
+ * watches are only touched with the dispatcher lock held. The callbacks
+ * are invoked with the lock held too, so that a watch which has been
+ * removed is never called again.
+ */
+typedef struct {
+    volatile gint ref_count;
+    GRecMutex lock;
+    /* NULL while there is nothing to watch */
+    GDBusConnection *connection;
+    GHashTable *subscriptions;
+    /* object path -> GSList of SsoSignalWatch */
+    GHashTable *watches;
+} SsoSignalDispatcher;
+
+struct _SsoSignalWatch {
+    SsoSignalDispatcher *dispatcher;
+    gchar *object_path;
+    GWeakRef proxy;
+    SsoSignalCallback callback;
+    gpointer user_data;
+};
+
+/*
+ * Each thread caches its SsoAuthService in a thread-local slot, so that the
+ * common lookup needs neither map_mutex nor a table lookup. The proxy is
+ * held by weak reference, as its last user may release it from any thread. The global table maps
+ * threads to their slots and is only used (under map_mutex) when a slot is
+ * created or torn down, and when the connection is lost.
+ * The slots are reference counted: the disconnect hooks and the pending
+ * disconnection notifications keep theirs alive even after the thread is
+ * gone, when the slot is detached. The hook list is locked, as the objects
+ * may remove their hooks from any thread.
+ */
+typedef struct {
+    volatile gint ref_count;
+    gboolean detached;
+    GThread *thread;
+    GMainContext *context;
+    GWeakRef object;
+    SsoAuthService *pinned;
+    GSList *pending;
+    GHookList disconnect_hooks;
+    GRecMutex hooks_lock;
+    gboolean reconnecting;
+    guint retries;
+    SsoSignalDispatcher *dispatcher;
+} SsoAuthServiceSlot;
+
+struct _SsoDisconnectHook {
+    SsoAuthServiceSlot *slot;
+    gulong hook_id;
+};
+
+/* Reconnection attempts after signond went away: 100ms, 200ms, ... 3.2s */
+#define RECONNECT_BASE_DELAY_MS 100
+#define RECONNECT_MAX_ATTEMPTS 6
+
+static void thread_slot_free (SsoAuthServiceSlot *slot);
+
 static GHashTable *thread_objects = NULL;
 static GMutex map_mutex;
+/* bumped every time a connection to signond is lost */
+static volatile gint connection_generation = 0;
+static GPrivate thread_slot = G_PRIVATE_INIT ((GDestroyNotify)thread_slot_free);
+#ifdef USE_P2P
+/* The P2P connection is shared by all threads; each thread still gets its
+ * own proxy, bound to its thread-default main context */
+static GWeakRef shared_connection;
+#endif
 
-static SsoAuthService *
-get_singleton ()
+static SsoSignalDispatcher *
+signal_dispatcher_new ()
+{
+    SsoSignalDispatcher *dispatcher;
+
+    dispatcher = g_slice_new0 (SsoSignalDispatcher);
+    dispatcher->ref_count = 1;
+    g_rec_mutex_init (&dispatcher->lock);
+    dispatcher->subscriptions = g_hash_table_new_full (g_str_hash,
+                                                       g_str_equal,
+                                                       g_free, NULL);
+    dispatcher->watches = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free, NULL);
+    return dispatcher;
+}
+
+static SsoSignalDispatcher *
+signal_dispatcher_ref (SsoSignalDispatcher *dispatcher)
+{
+    g_atomic_int_inc (&dispatcher->ref_count);
+    return dispatcher;
+}
+
+static void
+signal_dispatcher_unref (SsoSignalDispatcher *dispatcher)
+{
+    if (!g_atomic_int_dec_and_test (&dispatcher->ref_count))
+        return;
+
+    /* the subscriptions hold a reference */
+    g_warn_if_fail (g_hash_table_size (dispatcher->subscriptions) == 0);
+    g_warn_if_fail (g_hash_table_size (dispatcher->watches) == 0);
+
+    g_hash_table_unref (dispatcher->subscriptions);
+    g_hash_table_unref (dispatcher->watches);
+    g_rec_mutex_clear (&dispatcher->lock);
+    g_slice_free (SsoSignalDispatcher, dispatcher);
+}
+
+/*
+ * Don't keep the connection alive, nor the match rules installed, when
+ * there is nothing left to watch. Called with the dispatcher lock held.
+ */
+static void
+signal_dispatcher_reset_locked (SsoSignalDispatcher *dispatcher)
 {
-    SsoAuthService *object = NULL;
+    GHashTableIter iter;
+    gpointer subscription_id;
+
+    if (dispatcher->connection == NULL)
+        return;
+
+    g_hash_table_iter_init (&iter, dispatcher->subscriptions);
+    while (g_hash_table_iter_next (&iter, NULL, &subscription_id))
+        g_dbus_connection_signal_unsubscribe (dispatcher->connection,
+                                              GPOINTER_TO_UINT (subscription_id));
+    g_hash_table_remove_all (dispatcher->subscriptions);
+
+    g_clear_object (&dispatcher->connection);
+}
+
+/* Drops the reference of the thread slot; the watches left keep the
+ * dispatcher until they are removed */
+static void
+signal_dispatcher_release (SsoSignalDispatcher *dispatcher)
+{
+    g_rec_mutex_lock (&dispatcher->lock);
+    if (g_hash_table_size (dispatcher->watches) == 0)
+        signal_dispatcher_reset_locked (dispatcher);
+    g_rec_mutex_unlock (&dispatcher->lock);
+
+    signal_dispatcher_unref (dispatcher);
+}
+
+static SsoAuthServiceSlot *
+get_slot ()
+{
+    SsoAuthServiceSlot *slot;
+
+    slot = g_private_get (&thread_slot);
+    if (G_LIKELY (slot != NULL))
+        return slot;
+
+    slot = g_slice_new0 (SsoAuthServiceSlot);
+    slot->ref_count = 1;
+    slot->thread = g_thread_self ();
+    slot->context = g_main_context_ref_thread_default ();
+    g_weak_ref_init (&slot->object, NULL);
+    g_hook_list_init (&slot->disconnect_hooks, sizeof (GHook));
+    g_rec_mutex_init (&slot->hooks_lock);
+    g_private_set (&thread_slot, slot);
 
     g_mutex_lock (&map_mutex);
+    if (thread_objects == NULL)
+        thread_objects = g_hash_table_new (g_direct_hash, g_direct_equal);
+    g_hash_table_insert (thread_objects, slot->thread, slot);
+    g_mutex_unlock (&map_mutex);
+
+    return slot;
+}
+
+static SsoAuthServiceSlot *
+thread_slot_ref (SsoAuthServiceSlot *slot)
+{
+    g_atomic_int_inc (&slot->ref_count);
+    return slot;
+}
 
+static void
+thread_slot_unref (SsoAuthServiceSlot *slot)
+{
+    if (!g_atomic_int_dec_and_test (&slot->ref_count))
+        return;
+
+    g_weak_ref_clear (&slot->object);
+    g_rec_mutex_clear (&slot->hooks_lock);
+    g_main_context_unref (slot->context);
+    g_slice_free (SsoAuthServiceSlot, slot);
+}
+
+/* Called when the thread owning @slot exits */
+static void
+thread_slot_free (SsoAuthServiceSlot *slot)
+{
+    if (slot->pinned != NULL)
+        g_object_unref (slot->pinned);
+    slot->pinned = NULL;
+
+    g_mutex_lock (&map_mutex);
+    slot->detached = TRUE;
     if (thread_objects != NULL)
     {
-        GWeakRef *ref;
-        ref = g_hash_table_lookup (thread_objects, g_thread_self ());
-        if (ref != NULL)
+        g_hash_table_remove (thread_objects, slot->thread);
+        if (g_hash_table_size (thread_objects) == 0)
         {
-            object = g_weak_ref_get (ref);
+            g_hash_table_unref (thread_objects);
+            thread_objects = NULL;
         }
     }
-
     g_mutex_unlock (&map_mutex);
-    return object;
+
+    g_weak_ref_set (&slot->object, NULL);
+
+    g_warn_if_fail (slot->pending == NULL);
+    if (slot->dispatcher != NULL)
+        signal_dispatcher_release (slot->dispatcher);
+    slot->dispatcher = NULL;
+
+    g_rec_mutex_lock (&slot->hooks_lock);
+    g_hook_list_clear (&slot->disconnect_hooks);
+    g_rec_mutex_unlock (&slot->hooks_lock);
+
+    thread_slot_unref (slot);
 }
 
-static void
-g_thread_ref_free (GWeakRef *data)
+static SsoAuthService *
+get_singleton ()
 {
-    g_slice_free (GWeakRef, data);
+    SsoAuthServiceSlot *slot;
+
+    slot = g_private_get (&thread_slot);
+    if (slot == NULL)
+        return NULL;
+
+    return g_weak_ref_get (&slot->object);
 }
 
 static void
 set_singleton (SsoAuthService *object)
 {
+    SsoAuthServiceSlot *slot;
+
     g_return_if_fail (IS_SSO_AUTH_SERVICE (object));
 
+    slot = get_slot ();
+
     g_mutex_lock (&map_mutex);
+    g_weak_ref_set (&slot->object, object);
+    /* Disconnection notifications are delivered in the main context the
+     * proxy is bound to */
+    g_main_context_unref (slot->context);
+    slot->context = g_main_context_ref_thread_default ();
+    g_mutex_unlock (&map_mutex);
+}
 
-    if (thread_objects == NULL)
+/*
+ * Queue @res behind the bootstrap running in the calling thread. Returns
+ * %TRUE if a bootstrap was already in progress, %FALSE if the caller has to
+ * start one.
+ */
+static gboolean
+add_pending (GSimpleAsyncResult *res)
+{
+    SsoAuthServiceSlot *slot = get_slot ();
+    gboolean in_progress;
+
+    in_progress = (slot->pending != NULL);
+    slot->pending = g_slist_prepend (slot->pending, res);
+    return in_progress;
+}
+
+static GSList *
+steal_pending ()
+{
+    SsoAuthServiceSlot *slot = get_slot ();
+    GSList *pending;
+
+    pending = slot->pending;
+    slot->pending = NULL;
+    return g_slist_reverse (pending);
+}
+
+static void auth_service_connect ();
+
+static void
+auth_service_repin_cb (GObject *object, GAsyncResult *res, gpointer user_data)
+{
+    SsoAuthService *sso_auth_service;
+
+    (void)object;
+    (void)user_data;
+
+    sso_auth_service = sso_auth_service_get_instance_finish (res, NULL);
+    if (sso_auth_service != NULL)
     {
-        thread_objects = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                NULL, (GDestroyNotify)g_thread_ref_free);
+        sso_auth_service_pin_instance (sso_auth_service);
+        g_object_unref (sso_auth_service);
     }
+}
+
+/*
+ * Called in the main context of @slot when its connection to signond is
+ * lost: forget the proxy, so that the next request reconnects, and let the
+ * objects using it drop their remote objects. That is the thread owning
+ * @slot, unless the thread has no thread-default main context.
+ */
+static void
+thread_disconnected (SsoAuthServiceSlot *slot)
+{
+    SsoAuthService *object;
+    gboolean was_pinned;
 
-    if (object != NULL)
+    g_mutex_lock (&map_mutex);
+    if (slot->detached)
     {
-        GWeakRef *ref = g_slice_new (GWeakRef);
-        g_weak_ref_init (ref, object);
-        g_hash_table_insert (thread_objects, g_thread_self (), ref);
+        g_mutex_unlock (&map_mutex);
+        return;
     }
-
+    object = g_weak_ref_get (&slot->object);
+    g_weak_ref_set (&slot->object, NULL);
     g_mutex_unlock (&map_mutex);
+
+    if (object == NULL)
+        return;
+
+    DEBUG ("%s: connection to signond lost", G_STRFUNC);
+
+    g_atomic_int_inc (&connection_generation);
+
+    was_pinned = (slot->pinned != NULL);
+    g_clear_object (&slot->pinned);
+
+    slot->reconnecting = TRUE;
+    slot->retries = 0;
+
+    g_rec_mutex_lock (&slot->hooks_lock);
+    g_hook_list_invoke (&slot->disconnect_hooks, FALSE);
+    g_rec_mutex_unlock (&slot->hooks_lock);
+
+    if (slot->dispatcher != NULL)
+    {
+        signal_dispatcher_release (slot->dispatcher);
+        slot->dispatcher = NULL;
+    }
+
+    /* the new proxy has to be set up in the thread owning the slot */
+    if (was_pinned && slot->thread == g_thread_self ())
+        sso_auth_service_get_instance_async (NULL, auth_service_repin_cb,
+                                             NULL);
+
+    g_object_unref (object);
+}
+
+#ifdef USE_P2P
+static gboolean
+thread_disconnected_cb (gpointer user_data)
+{
+    thread_disconnected ((SsoAuthServiceSlot *)user_data);
+    return FALSE;
 }
 
 static void
-_on_auth_service_destroyed (gpointer data, GObject *obj)
+auth_service_connection_closed_cb (GDBusConnection *connection,
+                                   gboolean remote_peer_vanished,
+                                   GError *error,
+                                   gpointer user_data)
 {
-    (void)data;
-    (void)obj;
+    GHashTableIter iter;
+    SsoAuthServiceSlot *slot;
+
+    (void)remote_peer_vanished;
+    (void)user_data;
+
+    DEBUG ("%s: %s", G_STRFUNC, error ? error->message : "");
+
     g_mutex_lock (&map_mutex);
-    if (thread_objects)
     {
-        g_hash_table_unref (thread_objects);
-        thread_objects = NULL;
+        GDBusConnection *shared = g_weak_ref_get (&shared_connection);
+        if (shared == connection)
+            g_weak_ref_set (&shared_connection, NULL);
+        if (shared != NULL)
+            g_object_unref (shared);
+    }
+
+    /* Each thread has its own proxy and its own users of it: notify them
+     * in their own main context */
+    if (thread_objects != NULL)
+    {
+        g_hash_table_iter_init (&iter, thread_objects);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&slot))
+        {
+            GSource *source;
+            SsoAuthService *object;
+
+            object = g_weak_ref_get (&slot->object);
+            if (object == NULL)
+                continue;
+            g_object_unref (object);
+
+            source = g_idle_source_new ();
+            g_source_set_callback (source, thread_disconnected_cb,
+                                   thread_slot_ref (slot),
+                                   (GDestroyNotify)thread_slot_unref);
+            g_source_attach (source, slot->context);
+            g_source_unref (source);
+        }
     }
     g_mutex_unlock (&map_mutex);
 }
+#else
+static void
+auth_service_name_owner_cb (GObject *object, GParamSpec *pspec,
+                            gpointer user_data)
+{
+    SsoAuthServiceSlot *slot = user_data;
+    SsoAuthService *current;
+    gchar *name_owner;
 
+    (void)pspec;
 
-SsoAuthService *
-sso_auth_service_get_instance ()
+    name_owner = g_dbus_proxy_get_name_owner ((GDBusProxy *)object);
+    if (name_owner == NULL)
+    {
+        current = g_weak_ref_get (&slot->object);
+        if (current == (SsoAuthService *)object)
+            thread_disconnected (slot);
+        if (current != NULL)
+            g_object_unref (current);
+    }
+    g_free (name_owner);
+}
+
+static void
+auth_service_name_owner_notify (gpointer data, GClosure *closure)
+{
+    (void)closure;
+    thread_slot_unref ((SsoAuthServiceSlot *)data);
+}
+#endif
+
+static gboolean
+auth_service_reconnect_cb (gpointer user_data)
 {
-    SsoAuthService *sso_auth_service = NULL;
-    GDBusConnection *connection = NULL;
+    (void)user_data;
+    auth_service_connect ();
+    return FALSE;
+}
+
+/*
+ * After a disconnection signond might be restarting: retry with an
+ * exponential backoff before reporting the error to the callers.
+ */
+static gboolean
+schedule_reconnect ()
+{
+    SsoAuthServiceSlot *slot = get_slot ();
+    GSource *source;
+
+    if (!slot->reconnecting || slot->retries >= RECONNECT_MAX_ATTEMPTS)
+        return FALSE;
+
+    source = g_timeout_source_new (RECONNECT_BASE_DELAY_MS << slot->retries);
+    g_source_set_callback (source, auth_service_reconnect_cb, NULL, NULL);
+    g_source_attach (source, g_main_context_get_thread_default ());
+    g_source_unref (source);
+
+    slot->retries++;
+    return TRUE;
+}
+
+static void
+complete_pending (SsoAuthService *sso_auth_service, const GError *error)
+{
+    GSList *pending, *list;
+
+    pending = steal_pending ();
+    for (list = pending; list != NULL; list = list->next)
+    {
+        GSimpleAsyncResult *res = list->data;
+
+        if (sso_auth_service != NULL)
+            g_simple_async_result_set_op_res_gpointer (res,
+                                                       g_object_ref (sso_auth_service),
+                                                       g_object_unref);
+        else
+            g_simple_async_result_set_from_error (res, error);
+
+        g_simple_async_result_complete (res);
+        g_object_unref (res);
+    }
+    g_slist_free (pending);
+}
+
+static void
+auth_service_proxy_new_cb (GObject *object, GAsyncResult *res,
+                           gpointer user_data)
+{
+    SsoAuthService *sso_auth_service;
     GError *error = NULL;
 
-    sso_auth_service = get_singleton ();
-    if (sso_auth_service != NULL) return sso_auth_service;
+    (void)object;
+    (void)user_data;
 
-#ifdef USE_P2P
-    gchar *bus_address = g_strdup_printf (SIGNOND_BUS_ADDRESS, g_get_user_runtime_dir());
-    connection = g_dbus_connection_new_for_address_sync (bus_address,
-                                                         G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
-                                                         NULL,
-                                                         NULL,
-                                                         &error);
-    g_free (bus_address);
-#else
-    connection = g_bus_get_sync (SIGNOND_BUS_TYPE, NULL, &error);
+    sso_auth_service = sso_auth_service_proxy_new_finish (res, &error);
+    if (G_LIKELY (error == NULL))
+    {
+        SsoAuthServiceSlot *slot = get_slot ();
+
+        slot->reconnecting = FALSE;
+        slot->retries = 0;
+        set_singleton (sso_auth_service);
+#ifndef USE_P2P
+        g_signal_connect_data (sso_auth_service, "notify::g-name-owner",
+                               G_CALLBACK (auth_service_name_owner_cb),
+                               thread_slot_ref (slot),
+                               auth_service_name_owner_notify, 0);
 #endif
+    }
+    else
+    {
+        g_warning ("Couldn't activate signond: %s", error->message);
+    }
+
+    /* While at it, register the error mapping with GDBus */
+    signon_error_quark ();
+
+    complete_pending (sso_auth_service, error);
+
+    if (sso_auth_service != NULL)
+        g_object_unref (sso_auth_service);
+    g_clear_error (&error);
+}
+
+static void
+auth_service_create_proxy (GDBusConnection *connection)
+{
     /* Create the object */
-    sso_auth_service =
-        sso_auth_service_proxy_new_sync (connection,
-                                         G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
+    sso_auth_service_proxy_new (connection,
+                                G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
 #ifdef USE_P2P
-                                         NULL,
+                                NULL,
 #else
-                                         SIGNOND_SERVICE,
+                                SIGNOND_SERVICE,
 #endif
-                                         SIGNOND_DAEMON_OBJECTPATH,
-                                         NULL,
-                                         &error);
-    g_object_weak_ref (G_OBJECT (sso_auth_service), _on_auth_service_destroyed, sso_auth_service);
-    if (G_LIKELY (error == NULL)) {
-        set_singleton (sso_auth_service);
+                                SIGNOND_DAEMON_OBJECTPATH,
+                                NULL,
+                                auth_service_proxy_new_cb,
+                                NULL);
+}
+
+#ifdef USE_P2P
+static GDBusConnection *
+get_shared_connection ()
+{
+    return g_weak_ref_get (&shared_connection);
+}
+
+/* Returns the connection to be used: either @connection, which becomes the
+ * shared one, or the one another thread managed to set up in the meantime */
+static GDBusConnection *
+set_shared_connection (GDBusConnection *connection)
+{
+    GDBusConnection *shared;
+
+    g_mutex_lock (&map_mutex);
+    shared = g_weak_ref_get (&shared_connection);
+    if (shared == NULL)
+        g_weak_ref_set (&shared_connection, connection);
+    g_mutex_unlock (&map_mutex);
+
+    if (shared == NULL)
+    {
+        g_signal_connect (connection, "closed",
+                          G_CALLBACK (auth_service_connection_closed_cb),
+                          NULL);
+        return g_object_ref (connection);
     }
-    else
+
+    DEBUG ("%s: dropping duplicate connection", G_STRFUNC);
+    g_dbus_connection_close (connection, NULL, NULL, NULL);
+    return shared;
+}
+#endif
+
+static void
+auth_service_connection_cb (GObject *object, GAsyncResult *res,
+                            gpointer user_data)
+{
+    GDBusConnection *connection;
+    GError *error = NULL;
+
+    (void)object;
+    (void)user_data;
+
+#ifdef USE_P2P
+    connection = g_dbus_connection_new_for_address_finish (res, &error);
+#else
+    connection = g_bus_get_finish (res, &error);
+#endif
+    if (G_UNLIKELY (error != NULL))
     {
-        g_warning ("Couldn't activate signond: %s", error->message);
+        if (schedule_reconnect ())
+        {
+            DEBUG ("Couldn't reconnect to signond: %s", error->message);
+            g_clear_error (&error);
+            return;
+        }
+        g_warning ("Couldn't connect to signond: %s", error->message);
+        get_slot ()->reconnecting = FALSE;
+        complete_pending (NULL, error);
         g_clear_error (&error);
+        return;
     }
 
-    /* While at it, register the error mapping with GDBus */
-    signon_error_quark ();
+#ifdef USE_P2P
+    {
+        GDBusConnection *own_connection = connection;
+        connection = set_shared_connection (own_connection);
+        g_object_unref (own_connection);
+    }
+#endif
+
+    auth_service_create_proxy (connection);
+    g_object_unref (connection);
+}
+
+SsoAuthService *
+sso_auth_service_peek_instance ()
+{
+    return get_singleton ();
+}
+
+void
+sso_auth_service_pin_instance (SsoAuthService *sso_auth_service)
+{
+    SsoAuthServiceSlot *slot;
+
+    g_return_if_fail (IS_SSO_AUTH_SERVICE (sso_auth_service));
+
+    slot = get_slot ();
+    if (slot->pinned == NULL)
+        slot->pinned = g_object_ref (sso_auth_service);
+}
+
+void
+sso_auth_service_get_instance_async (GCancellable *cancellable,
+                                     GAsyncReadyCallback callback,
+                                     gpointer user_data)
+{
+    SsoAuthService *sso_auth_service;
+    GSimpleAsyncResult *res;
+
+    res = g_simple_async_result_new (NULL, callback, user_data,
+                                     sso_auth_service_get_instance_async);
+    g_simple_async_result_set_check_cancellable (res, cancellable);
+
+    sso_auth_service = get_singleton ();
+    if (sso_auth_service != NULL)
+    {
+        g_simple_async_result_set_op_res_gpointer (res, sso_auth_service,
+                                                   g_object_unref);
+        g_simple_async_result_complete_in_idle (res);
+        g_object_unref (res);
+        return;
+    }
+
+    /* Only the first request in a thread opens the connection; the others
+     * are completed together with it */
+    if (add_pending (res))
+        return;
+
+    auth_service_connect ();
+}
+
+static void
+auth_service_connect ()
+{
+#ifdef USE_P2P
+    GDBusConnection *connection = get_shared_connection ();
+    if (connection != NULL)
+    {
+        auth_service_create_proxy (connection);
+        g_object_unref (connection);
+        return;
+    }
+
+    gchar *bus_address = g_strdup_printf (SIGNOND_BUS_ADDRESS, g_get_user_runtime_dir());
+    g_dbus_connection_new_for_address (bus_address,
+                                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+                                       NULL,
+                                       NULL,
+                                       auth_service_connection_cb,
+                                       NULL);
+    g_free (bus_address);
+#else
+    g_bus_get (SIGNOND_BUS_TYPE, NULL, auth_service_connection_cb, NULL);
+#endif
+}
+
+/*
+ * @func is called in the main context of the calling thread when the
+ * connection to signond is lost, until the returned hook is passed to
+ * sso_auth_service_remove_disconnect_hook(), from any thread.
+ */
+SsoDisconnectHook *
+sso_auth_service_add_disconnect_hook (GHookFunc func, gpointer data)
+{
+    SsoDisconnectHook *handle;
+    SsoAuthServiceSlot *slot;
+    GHook *hook;
+
+    g_return_val_if_fail (func != NULL, NULL);
+
+    slot = get_slot ();
+
+    g_rec_mutex_lock (&slot->hooks_lock);
+    hook = g_hook_alloc (&slot->disconnect_hooks);
+    hook->func = func;
+    hook->data = data;
+    g_hook_append (&slot->disconnect_hooks, hook);
+    g_rec_mutex_unlock (&slot->hooks_lock);
+
+    handle = g_slice_new (SsoDisconnectHook);
+    handle->slot = thread_slot_ref (slot);
+    handle->hook_id = hook->hook_id;
+    return handle;
+}
+
+void
+sso_auth_service_remove_disconnect_hook (SsoDisconnectHook *handle)
+{
+    SsoAuthServiceSlot *slot;
+
+    g_return_if_fail (handle != NULL);
+
+    slot = handle->slot;
+
+    /* the list is empty once the thread is gone */
+    g_rec_mutex_lock (&slot->hooks_lock);
+    if (!slot->detached)
+        g_hook_destroy (&slot->disconnect_hooks, handle->hook_id);
+    g_rec_mutex_unlock (&slot->hooks_lock);
+
+    thread_slot_unref (slot);
+    g_slice_free (SsoDisconnectHook, handle);
+}
+
+guint
+sso_auth_service_get_generation ()
+{
+    return g_atomic_int_get (&connection_generation);
+}
+
+static void
+signal_dispatcher_cb (GDBusConnection *connection,
+                      const gchar *sender_name,
+                      const gchar *object_path,
+                      const gchar *interface_name,
+                      const gchar *signal_name,
+                      GVariant *parameters,
+                      gpointer user_data)
+{
+    SsoSignalDispatcher *dispatcher = user_data;
+    GSList *watches, *list;
+
+    (void)sender_name;
+
+    g_rec_mutex_lock (&dispatcher->lock);
+    if (dispatcher->connection != connection)
+        goto out;
+
+    /* the callbacks may remove watches, even the ones still to be called */
+    watches = g_slist_copy (g_hash_table_lookup (dispatcher->watches,
+                                                 object_path));
+    for (list = watches; list != NULL; list = list->next)
+    {
+        SsoSignalWatch *watch = list->data;
+        GDBusProxy *proxy;
+
+        if (!g_slist_find (g_hash_table_lookup (dispatcher->watches,
+                                                object_path), watch))
+            continue;
+
+        proxy = g_weak_ref_get (&watch->proxy);
+        if (proxy == NULL)
+            continue;
+
+        if (g_strcmp0 (g_dbus_proxy_get_interface_name (proxy),
+                       interface_name) == 0)
+            watch->callback (proxy, signal_name, parameters,
+                             watch->user_data);
+        g_object_unref (proxy);
+    }
+    g_slist_free (watches);
+
+out:
+    g_rec_mutex_unlock (&dispatcher->lock);
+}
+
+/*
+ * Routes the signals of the remote object behind @proxy to @callback, in
+ * the calling thread, until sso_auth_service_unwatch_object() is called
+ * on the returned watch, from any thread.
+ */
+SsoSignalWatch *
+sso_auth_service_watch_object (GDBusProxy *proxy,
+                               SsoSignalCallback callback,
+                               gpointer user_data)
+{
+    SsoAuthServiceSlot *slot;
+    SsoSignalDispatcher *dispatcher;
+    SsoSignalWatch *watch;
+    GDBusConnection *connection;
+    const gchar *interface_name;
+    GSList *watches;
+
+    g_return_val_if_fail (G_IS_DBUS_PROXY (proxy), NULL);
+    g_return_val_if_fail (callback != NULL, NULL);
+
+    slot = get_slot ();
+    connection = g_dbus_proxy_get_connection (proxy);
+    interface_name = g_dbus_proxy_get_interface_name (proxy);
+
+    if (slot->dispatcher == NULL)
+        slot->dispatcher = signal_dispatcher_new ();
+    dispatcher = slot->dispatcher;
+
+    g_rec_mutex_lock (&dispatcher->lock);
+
+    if (dispatcher->connection != NULL &&
+        dispatcher->connection != connection)
+    {
+        /* the watches on the old connection are left to go away */
+        g_rec_mutex_unlock (&dispatcher->lock);
+        signal_dispatcher_release (dispatcher);
+        slot->dispatcher = signal_dispatcher_new ();
+        dispatcher = slot->dispatcher;
+        g_rec_mutex_lock (&dispatcher->lock);
+    }
+    if (dispatcher->connection == NULL)
+        dispatcher->connection = g_object_ref (connection);
+
+    if (!g_hash_table_contains (dispatcher->subscriptions, interface_name))
+    {
+        guint subscription_id;
+
+        subscription_id =
+            g_dbus_connection_signal_subscribe (connection,
+                                                g_dbus_proxy_get_name (proxy),
+                                                interface_name,
+                                                NULL,
+                                                NULL,
+                                                NULL,
+                                                G_DBUS_SIGNAL_FLAGS_NONE,
+                                                signal_dispatcher_cb,
+                                                signal_dispatcher_ref (dispatcher),
+                                                (GDestroyNotify)signal_dispatcher_unref);
+        g_hash_table_insert (dispatcher->subscriptions,
+                             g_strdup (interface_name),
+                             GUINT_TO_POINTER (subscription_id));
+    }
+
+    watch = g_slice_new (SsoSignalWatch);
+    watch->dispatcher = signal_dispatcher_ref (dispatcher);
+    watch->object_path = g_strdup (g_dbus_proxy_get_object_path (proxy));
+    g_weak_ref_init (&watch->proxy, proxy);
+    watch->callback = callback;
+    watch->user_data = user_data;
+
+    /* several proxies may be watching the same remote object */
+    watches = g_hash_table_lookup (dispatcher->watches, watch->object_path);
+    watches = g_slist_append (watches, watch);
+    g_hash_table_replace (dispatcher->watches, g_strdup (watch->object_path),
+                          watches);
+
+    g_rec_mutex_unlock (&dispatcher->lock);
+
+    return watch;
+}
+
+void
+sso_auth_service_unwatch_object (SsoSignalWatch *watch)
+{
+    SsoSignalDispatcher *dispatcher;
+    GSList *watches;
+
+    g_return_if_fail (watch != NULL);
+
+    dispatcher = watch->dispatcher;
+
+    g_rec_mutex_lock (&dispatcher->lock);
+
+    watches = g_hash_table_lookup (dispatcher->watches, watch->object_path);
+    watches = g_slist_remove (watches, watch);
+    if (watches != NULL)
+        g_hash_table_replace (dispatcher->watches,
+                              g_strdup (watch->object_path), watches);
+    else
+        g_hash_table_remove (dispatcher->watches, watch->object_path);
+
+    if (g_hash_table_size (dispatcher->watches) == 0)
+        signal_dispatcher_reset_locked (dispatcher);
+
+    g_rec_mutex_unlock (&dispatcher->lock);
+
+    g_weak_ref_clear (&watch->proxy);
+    g_free (watch->object_path);
+    g_slice_free (SsoSignalWatch, watch);
+    signal_dispatcher_unref (dispatcher);
+}
+
+SsoAuthService *
+sso_auth_service_get_instance_finish (GAsyncResult *res, GError **error)
+{
+    GSimpleAsyncResult *simple = (GSimpleAsyncResult *)res;
+
+    g_return_val_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res), NULL);
+
+    if (g_simple_async_result_propagate_error (simple, error))
+        return NULL;
 
-    return sso_auth_service;
+    return g_object_ref (g_simple_async_result_get_op_res_gpointer (simple));
 }
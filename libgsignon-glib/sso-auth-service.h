@@ -29,8 +29,46 @@
 
 G_BEGIN_DECLS
 
+typedef struct _SsoSignalWatch SsoSignalWatch;
+typedef struct _SsoDisconnectHook SsoDisconnectHook;
+
+typedef void (*SsoSignalCallback) (GDBusProxy *proxy,
+                                   const gchar *signal_name,
+                                   GVariant *parameters,
+                                   gpointer user_data);
+
+G_GNUC_INTERNAL
+SsoAuthService *sso_auth_service_peek_instance ();
+
+G_GNUC_INTERNAL
+void sso_auth_service_pin_instance (SsoAuthService *sso_auth_service);
+
+G_GNUC_INTERNAL
+void sso_auth_service_get_instance_async (GCancellable *cancellable,
+                                          GAsyncReadyCallback callback,
+                                          gpointer user_data);
+
+G_GNUC_INTERNAL
+SsoAuthService *sso_auth_service_get_instance_finish (GAsyncResult *res,
+                                                      GError **error);
+
+G_GNUC_INTERNAL
+SsoDisconnectHook *sso_auth_service_add_disconnect_hook (GHookFunc func,
+                                                         gpointer data);
+
+G_GNUC_INTERNAL
+void sso_auth_service_remove_disconnect_hook (SsoDisconnectHook *hook);
+
+G_GNUC_INTERNAL
+guint sso_auth_service_get_generation ();
+
+G_GNUC_INTERNAL
+SsoSignalWatch *sso_auth_service_watch_object (GDBusProxy *proxy,
+                                               SsoSignalCallback callback,
+                                               gpointer user_data);
+
 G_GNUC_INTERNAL
-SsoAuthService *sso_auth_service_get_instance ();
+void sso_auth_service_unwatch_object (SsoSignalWatch *watch);
 
 G_END_DECLS
 
@@ -168,6 +168,37 @@ START_TEST(test_init)
 }
 END_TEST
 
+static void
+auth_service_new_async_cb (GObject *source_object, GAsyncResult *res,
+                           gpointer user_data)
+{
+    GError *error = NULL;
+
+    auth_service = signon_auth_service_new_finish (res, &error);
+    if (error)
+    {
+        g_warning ("%s: %s", G_STRFUNC, error->message);
+        g_error_free (error);
+        _stop_mainloop ();
+        fail();
+    }
+
+    fail_unless (SIGNON_IS_AUTH_SERVICE (auth_service),
+                 "Failed to initialize the AuthService.");
+    fail_unless (g_strcmp0 (user_data, "Hello") == 0, "Got wrong string");
+
+    _stop_mainloop ();
+}
+
+START_TEST(test_init_async)
+{
+    g_debug("%s", G_STRFUNC);
+
+    signon_auth_service_new_async (NULL, auth_service_new_async_cb, "Hello");
+    _run_mainloop ();
+}
+END_TEST
+
 static void
 signon_query_methods_cb (SignonAuthService *auth_service, gchar **methods,
                          GError *error, gpointer user_data)
@@ -530,6 +561,68 @@ START_TEST(test_auth_session_creation)
 }
 END_TEST
 
+START_TEST(test_auth_session_limit)
+{
+    GError *err = NULL;
+    SignonAuthSession *sessions[3];
+    SignonAuthSession *extra;
+    gint i;
+
+    g_debug("%s", G_STRFUNC);
+    SignonIdentity *idty = signon_identity_new();
+    fail_unless (idty != NULL, "Cannot create Identity object");
+    fail_unless (signon_identity_get_max_sessions_per_method (idty) == 1);
+
+    /* by default, only one session per method */
+    sessions[0] = signon_identity_create_session (idty, "ssotest", &err);
+    fail_unless (sessions[0] != NULL, "Cannot create AuthSession object");
+    fail_unless (err == NULL);
+
+    extra = signon_identity_create_session (idty, "ssotest", &err);
+    fail_unless (extra == NULL, "Second session must be rejected");
+    fail_unless (g_error_matches (err, SIGNON_ERROR,
+                                  SIGNON_ERROR_METHOD_NOT_AVAILABLE));
+    g_clear_error (&err);
+
+    /* other methods are counted separately */
+    extra = signon_identity_create_session (idty, "nonexisting", &err);
+    fail_unless (extra != NULL, "Cannot create AuthSession object");
+    g_object_unref (extra);
+
+    /* destroying a session frees its slot */
+    g_object_unref (sessions[0]);
+    sessions[0] = signon_identity_create_session (idty, "ssotest", &err);
+    fail_unless (sessions[0] != NULL, "Session slot was not released");
+    fail_unless (err == NULL);
+
+    /* raising the limit allows that many sessions */
+    signon_identity_set_max_sessions_per_method (idty, 3);
+    fail_unless (signon_identity_get_max_sessions_per_method (idty) == 3);
+    for (i = 1; i < 3; i++)
+    {
+        sessions[i] = signon_identity_create_session (idty, "ssotest", &err);
+        fail_unless (sessions[i] != NULL, "Cannot create AuthSession object");
+        fail_unless (err == NULL);
+    }
+
+    extra = signon_identity_create_session (idty, "ssotest", &err);
+    fail_unless (extra == NULL, "Session beyond the limit must be rejected");
+    fail_unless (g_error_matches (err, SIGNON_ERROR,
+                                  SIGNON_ERROR_METHOD_NOT_AVAILABLE));
+    g_clear_error (&err);
+
+    /* zero means no limit */
+    signon_identity_set_max_sessions_per_method (idty, 0);
+    extra = signon_identity_create_session (idty, "ssotest", &err);
+    fail_unless (extra != NULL, "Cannot create AuthSession object");
+    g_object_unref (extra);
+
+    for (i = 0; i < 3; i++)
+        g_object_unref (sessions[i]);
+    g_object_unref (idty);
+}
+END_TEST
+
 START_TEST(test_auth_session_process)
 {
     gint state_counter = 0;
@@ -681,6 +774,449 @@ START_TEST(test_auth_session_process_failure)
 }
 END_TEST
 
+static void
+test_auth_session_process_queue_cb (GObject *source_object,
+                                    GAsyncResult *res,
+                                    gpointer user_data)
+{
+    SignonAuthSession *auth_session = SIGNON_AUTH_SESSION (source_object);
+    gint *results = user_data;
+    GVariant *v_reply;
+    GError *error = NULL;
+
+    v_reply = signon_auth_session_process_finish (auth_session, res, &error);
+    fail_unless (v_reply == NULL);
+    fail_unless (error != NULL);
+    fail_unless (error->domain == SIGNON_ERROR);
+
+    if (error->code == SIGNON_ERROR_SERVICE_NOT_AVAILABLE)
+        results[0]++;
+    else if (error->code == SIGNON_ERROR_MECHANISM_NOT_AVAILABLE)
+        results[1]++;
+    g_error_free (error);
+
+    if (results[0] + results[1] == 3)
+        _stop_mainloop ();
+}
+
+START_TEST(test_auth_session_process_queue)
+{
+    SignonIdentity *idty;
+    SignonAuthSession *auth_session;
+    GError *error = NULL;
+    gint results[2] = { 0, 0 };
+    gint i;
+
+    g_debug("%s", G_STRFUNC);
+
+    guint id = new_identity();
+
+    fail_unless (id != 0);
+
+    idty = signon_identity_new_from_db (id);
+
+    fail_unless (idty != NULL, "Cannot create Identity object");
+    auth_session = signon_auth_session_new_for_identity (idty,
+                                                         "ssotest",
+                                                         &error);
+    fail_unless (auth_session != NULL, "Cannot create AuthSession object");
+    fail_unless (error == NULL);
+
+    /* one request on the wire, one waiting and one rejected */
+    signon_auth_session_set_queue_limits (auth_session, 1, 1);
+
+    for (i = 0; i < 3; i++)
+    {
+        GVariantBuilder builder;
+
+        g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+        g_variant_builder_add (&builder, "{sv}",
+                               "key", g_variant_new_string ("value"));
+        signon_auth_session_process_full (auth_session,
+                                          g_variant_builder_end (&builder),
+                                          "mechx",
+                                          G_PRIORITY_DEFAULT,
+                                          NULL,
+                                          test_auth_session_process_queue_cb,
+                                          results);
+    }
+    fail_unless (signon_auth_session_get_pending_requests (auth_session) == 1);
+
+    _run_mainloop ();
+    fail_unless (results[0] == 1);
+    fail_unless (results[1] == 2);
+    fail_unless (signon_auth_session_get_pending_requests (auth_session) == 0);
+
+    g_object_unref (auth_session);
+    g_object_unref (idty);
+}
+END_TEST
+
+static void
+test_auth_session_process_batch_item_cb (SignonAuthSession *self,
+                                         guint index,
+                                         GVariant *reply,
+                                         const GError *error,
+                                         gpointer user_data)
+{
+    guint *seen = user_data;
+
+    fail_unless (index < 2);
+    fail_unless (reply == NULL);
+    fail_unless (error != NULL);
+    fail_unless (error->code == SIGNON_ERROR_MECHANISM_NOT_AVAILABLE);
+    seen[index]++;
+}
+
+static void
+test_auth_session_process_batch_cb (GObject *source_object,
+                                    GAsyncResult *res,
+                                    gpointer user_data)
+{
+    GError *error = NULL;
+
+    fail_unless (signon_auth_session_process_batch_finish (
+        SIGNON_AUTH_SESSION (source_object), res, &error));
+    fail_unless (error == NULL);
+
+    _stop_mainloop ();
+}
+
+START_TEST(test_auth_session_process_batch)
+{
+    SignonIdentity *idty;
+    SignonAuthSession *auth_session;
+    GVariantBuilder builder;
+    GError *error = NULL;
+    guint seen[2] = { 0, 0 };
+
+    g_debug("%s", G_STRFUNC);
+
+    guint id = new_identity();
+
+    fail_unless (id != 0);
+
+    idty = signon_identity_new_from_db (id);
+
+    fail_unless (idty != NULL, "Cannot create Identity object");
+    auth_session = signon_auth_session_new_for_identity (idty,
+                                                         "ssotest",
+                                                         &error);
+    fail_unless (auth_session != NULL, "Cannot create AuthSession object");
+    fail_unless (error == NULL);
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sa{sv})"));
+    g_variant_builder_add (&builder, "(s@a{sv})", "mechx",
+                           g_variant_new_array (G_VARIANT_TYPE ("{sv}"),
+                                                NULL, 0));
+    g_variant_builder_add (&builder, "(s@a{sv})", "mechy",
+                           g_variant_new_array (G_VARIANT_TYPE ("{sv}"),
+                                                NULL, 0));
+
+    signon_auth_session_process_batch_async (auth_session,
+                                             g_variant_builder_end (&builder),
+                                             NULL,
+                                             test_auth_session_process_batch_item_cb,
+                                             seen,
+                                             test_auth_session_process_batch_cb,
+                                             NULL);
+    _run_mainloop ();
+    fail_unless (seen[0] == 1);
+    fail_unless (seen[1] == 1);
+
+    g_object_unref (auth_session);
+    g_object_unref (idty);
+}
+END_TEST
+
+static void
+test_auth_session_shared_cb (GObject *source_object,
+                             GAsyncResult *res,
+                             gpointer user_data)
+{
+    GVariant **replies = user_data;
+    GError *error = NULL;
+    GVariant *v_reply;
+    gint i;
+
+    v_reply = signon_auth_session_process_finish (
+        SIGNON_AUTH_SESSION (source_object), res, &error);
+
+    /* slot 0 for the cancelled session, 1 and 2 for the others */
+    if (v_reply == NULL)
+    {
+        fail_unless (error != NULL);
+        fail_unless (error->code == SIGNON_ERROR_SESSION_CANCELED,
+                     "Got error: %s", error->message);
+        g_error_free (error);
+        replies[0] = (GVariant *)source_object;
+    }
+    else
+    {
+        i = replies[1] == NULL ? 1 : 2;
+        replies[i] = v_reply;
+    }
+
+    if (replies[0] != NULL && replies[1] != NULL && replies[2] != NULL)
+        _stop_mainloop ();
+}
+
+static GVariant *
+test_auth_session_shared_data ()
+{
+    GVariantBuilder builder;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&builder, "{sv}", SIGNON_SESSION_DATA_USERNAME,
+                           g_variant_new_string ("test_username"));
+    g_variant_builder_add (&builder, "{sv}", SIGNON_SESSION_DATA_SECRET,
+                           g_variant_new_string ("test_username"));
+    return g_variant_builder_end (&builder);
+}
+
+START_TEST(test_auth_session_shared_requests)
+{
+    SignonIdentity *idty;
+    SignonAuthSession *sessions[3];
+    GVariant *replies[3] = { NULL, NULL, NULL };
+    GError *error = NULL;
+    gint i;
+
+    g_debug("%s", G_STRFUNC);
+
+    guint id = new_identity();
+    fail_unless (id != 0);
+
+    idty = signon_identity_new_from_db (id);
+    fail_unless (idty != NULL, "Cannot create Identity object");
+    signon_identity_set_max_sessions_per_method (idty, 3);
+
+    for (i = 0; i < 3; i++)
+    {
+        sessions[i] = signon_identity_create_session (idty, "ssotest", &error);
+        fail_unless (sessions[i] != NULL, "Cannot create AuthSession object");
+        fail_unless (error == NULL);
+        signon_auth_session_set_share_requests (sessions[i], TRUE);
+
+        signon_auth_session_process_async (sessions[i],
+                                           test_auth_session_shared_data (),
+                                           "mech1",
+                                           NULL,
+                                           test_auth_session_shared_cb,
+                                           replies);
+    }
+
+    /* Cancelling the session owning the request must not fail the others */
+    signon_auth_session_cancel (sessions[0]);
+
+    _run_mainloop ();
+    fail_unless (replies[0] == (GVariant *)sessions[0]);
+    fail_unless (replies[1] != NULL);
+    fail_unless (replies[1] == replies[2], "The reply was not shared");
+
+    g_variant_unref (replies[1]);
+    g_variant_unref (replies[2]);
+    for (i = 0; i < 3; i++)
+        g_object_unref (sessions[i]);
+    g_object_unref (idty);
+}
+END_TEST
+
+typedef struct {
+    GVariant *reply;
+    GError *error;
+} TestProcessResult;
+
+static void
+test_result_cache_cb (GObject *source_object,
+                      GAsyncResult *res,
+                      gpointer user_data)
+{
+    TestProcessResult *result = user_data;
+
+    result->reply = signon_auth_session_process_finish (
+        SIGNON_AUTH_SESSION (source_object), res, &result->error);
+    _stop_mainloop ();
+}
+
+static GVariant *
+test_result_cache_process (SignonAuthSession *auth_session,
+                           gint32 expires_in)
+{
+    TestProcessResult result = { NULL, NULL };
+    GVariantBuilder builder;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&builder, "{sv}", SIGNON_SESSION_DATA_USERNAME,
+                           g_variant_new_string ("test_username"));
+    g_variant_builder_add (&builder, "{sv}", SIGNON_SESSION_DATA_SECRET,
+                           g_variant_new_string ("test_username"));
+    /* the test plugin copies the session data into its reply */
+    if (expires_in != 0)
+        g_variant_builder_add (&builder, "{sv}", "ExpiresIn",
+                               g_variant_new_int32 (expires_in));
+
+    signon_auth_session_process_async (auth_session,
+                                       g_variant_builder_end (&builder),
+                                       "mech1",
+                                       NULL,
+                                       test_result_cache_cb,
+                                       &result);
+    _run_mainloop ();
+
+    if (result.error != NULL)
+    {
+        fail_unless (result.reply == NULL);
+        g_error_free (result.error);
+    }
+    return result.reply;
+}
+
+static SignonAuthSession *
+test_result_cache_session (guint *id, SignonIdentity **idty)
+{
+    SignonAuthSession *auth_session;
+    GError *error = NULL;
+
+    *id = new_identity ();
+    fail_unless (*id != 0);
+
+    *idty = signon_identity_new_from_db (*id);
+    fail_unless (*idty != NULL, "Cannot create Identity object");
+
+    auth_session = signon_identity_create_session (*idty, "ssotest", &error);
+    fail_unless (auth_session != NULL, "Cannot create AuthSession object");
+    fail_unless (error == NULL);
+
+    return auth_session;
+}
+
+START_TEST(test_auth_session_result_cache)
+{
+    SignonIdentity *idty;
+    SignonAuthSession *auth_session;
+    GVariant *first, *second;
+    guint id;
+
+    g_debug("%s", G_STRFUNC);
+
+    auth_session = test_result_cache_session (&id, &idty);
+
+    /* disabled by default */
+    first = test_result_cache_process (auth_session, 0);
+    second = test_result_cache_process (auth_session, 0);
+    fail_unless (first != NULL && second != NULL);
+    fail_unless (first != second, "Reply cached without being enabled");
+    g_variant_unref (first);
+    g_variant_unref (second);
+
+    /* a hit within the lifetime returns the stored reply */
+    signon_auth_session_set_result_cache_lifetime (auth_session, 1);
+    first = test_result_cache_process (auth_session, 0);
+    second = test_result_cache_process (auth_session, 0);
+    fail_unless (first != NULL);
+    fail_unless (first == second, "Reply was not cached");
+    g_variant_unref (second);
+
+    /* once expired, the daemon is asked again */
+    g_usleep (1500 * 1000);
+    second = test_result_cache_process (auth_session, 0);
+    fail_unless (second != NULL);
+    fail_unless (first != second, "Expired reply was returned");
+    g_variant_unref (first);
+    g_variant_unref (second);
+
+    /* ExpiresIn shortens the lifetime, but cannot extend it */
+    signon_auth_session_set_result_cache_lifetime (auth_session, 60);
+    first = test_result_cache_process (auth_session, 1);
+    second = test_result_cache_process (auth_session, 1);
+    fail_unless (first != NULL);
+    fail_unless (first == second, "Reply was not cached");
+    g_variant_unref (second);
+    g_usleep (1500 * 1000);
+    second = test_result_cache_process (auth_session, 1);
+    fail_unless (first != second, "ExpiresIn was not honoured");
+    g_variant_unref (first);
+    g_variant_unref (second);
+
+    signon_auth_session_set_result_cache_lifetime (auth_session, 1);
+    first = test_result_cache_process (auth_session, 60);
+    g_usleep (1500 * 1000);
+    second = test_result_cache_process (auth_session, 60);
+    fail_unless (first != second, "ExpiresIn extended the lifetime");
+    g_variant_unref (first);
+    g_variant_unref (second);
+
+    g_object_unref (auth_session);
+    g_object_unref (idty);
+}
+END_TEST
+
+static void
+test_result_cache_removed_cb (SignonIdentity *self,
+                              const GError *error,
+                              gpointer user_data)
+{
+    fail_unless (error == NULL);
+    _stop_mainloop ();
+}
+
+START_TEST(test_auth_session_result_cache_invalidation)
+{
+    SignonIdentity *idty;
+    SignonAuthSession *auth_session;
+    GHashTable *methods;
+    GVariant *first, *second;
+    guint id, stored_id = 0;
+
+    g_debug("%s", G_STRFUNC);
+
+    auth_session = test_result_cache_session (&id, &idty);
+    signon_auth_session_set_result_cache_lifetime (auth_session, 60);
+
+    first = test_result_cache_process (auth_session, 0);
+    fail_unless (first != NULL);
+
+    /* updating the identity drops its cached replies */
+    methods = g_hash_table_new (g_str_hash, g_str_equal);
+    g_hash_table_insert (methods, "ssotest", ssotest_mechanisms);
+    signon_identity_store_credentials_with_args (idty,
+                                                 "James Bond",
+                                                 "007",
+                                                 TRUE,
+                                                 methods,
+                                                 "MI-6 updated",
+                                                 NULL,
+                                                 NULL,
+                                                 NULL,
+                                                 0,
+                                                 new_identity_store_credentials_cb,
+                                                 &stored_id);
+    g_hash_table_destroy (methods);
+    if (stored_id == 0)
+        _run_mainloop ();
+    fail_unless (stored_id == id);
+
+    second = test_result_cache_process (auth_session, 0);
+    fail_unless (second != NULL);
+    fail_unless (first != second, "Cached reply survived an update");
+    g_variant_unref (first);
+
+    /* and so does removing it */
+    signon_identity_remove (idty, test_result_cache_removed_cb, NULL);
+    _run_mainloop ();
+
+    first = test_result_cache_process (auth_session, 0);
+    fail_unless (first != second, "Cached reply survived the removal");
+    if (first != NULL)
+        g_variant_unref (first);
+    g_variant_unref (second);
+
+    g_object_unref (auth_session);
+    g_object_unref (idty);
+}
+END_TEST
+
 static void
 test_auth_session_process_after_store_cb (SignonAuthSession *self,
                                           GHashTable *reply,
@@ -850,6 +1386,35 @@ START_TEST(test_get_nonexisting_identity)
 }
 END_TEST
 
+START_TEST(test_get_shared_identity)
+{
+    g_debug("%s", G_STRFUNC);
+    SignonIdentity *other;
+    guint id = new_identity();
+
+    fail_unless (id != 0);
+
+    identity = signon_identity_get_from_db (id);
+    fail_unless (identity != NULL);
+
+    other = signon_identity_get_from_db (id);
+    fail_unless (other == identity, "The identity was not shared");
+    g_object_unref (other);
+
+    other = signon_identity_get_with_context_from_db (id, "*");
+    fail_unless (other != identity,
+                 "The identity was shared across application contexts");
+    g_object_unref (other);
+
+    g_timeout_add (1000, identity_registeration_timeout_cb, identity);
+    _run_mainloop ();
+
+    const GError *error = NULL;
+    error = signon_identity_get_last_error(identity);
+    fail_unless (error == NULL);
+}
+END_TEST
+
 static void store_credentials_identity_cb(SignonIdentity *self,
                                          guint32 id,
                                          const GError *error,
@@ -1382,6 +1947,362 @@ START_TEST(test_query_identities)
 }
 END_TEST
 
+static void
+query_identities_with_fields_cb (SignonAuthService *auth_service,
+                                 SignonIdentityList *identity_list,
+                                 const GError *error,
+                                 gpointer user_data)
+{
+    SignonIdentityList *iter = identity_list;
+    guint32 id = GPOINTER_TO_UINT (user_data);
+    gboolean found = FALSE;
+
+    fail_unless (error == NULL, "There should be no error in callback");
+
+    while (iter)
+    {
+        SignonIdentityInfo *info = (SignonIdentityInfo *) iter->data;
+
+        fail_unless (signon_identity_info_get_id (info) != 0,
+                     "Requested field was not decoded");
+        fail_unless (signon_identity_info_get_username (info) == NULL,
+                     "Unrequested field was decoded");
+        fail_unless (g_hash_table_size (signon_identity_info_get_methods (info)) == 0,
+                     "Unrequested field was decoded");
+
+        if ((guint32) signon_identity_info_get_id (info) == id)
+        {
+            found = TRUE;
+            fail_unless (g_strcmp0 (signon_identity_info_get_caption (info),
+                                    "MI-6") == 0, "Wrong caption in identity");
+        }
+
+        iter = g_list_next (iter);
+    }
+    g_list_free_full (identity_list,
+                      (GDestroyNotify) signon_identity_info_free);
+
+    fail_unless (found, "Identity not returned");
+    _stop_mainloop ();
+}
+
+START_TEST(test_query_identities_with_fields)
+{
+    guint id;
+
+    g_debug("%s", G_STRFUNC);
+
+    id = new_identity ();
+    fail_unless (id != 0);
+
+    SignonAuthService *asrv = signon_auth_service_new ();
+
+    signon_auth_service_query_identities_with_fields (asrv, NULL, NULL,
+                                                      SIGNON_IDENTITY_INFO_FIELD_ID |
+                                                      SIGNON_IDENTITY_INFO_FIELD_CAPTION,
+                                                      query_identities_with_fields_cb,
+                                                      GUINT_TO_POINTER (id));
+    _run_mainloop ();
+
+    g_object_unref (asrv);
+}
+END_TEST
+
+static void
+query_identities_filtered_cb (SignonAuthService *auth_service,
+                              SignonIdentityList *identity_list,
+                              const GError *error,
+                              gpointer user_data)
+{
+    SignonIdentityList **result = user_data;
+
+    fail_unless (error == NULL, "There should be no error in callback");
+    *result = identity_list;
+    _stop_mainloop ();
+}
+
+START_TEST(test_query_identities_filtered_fields)
+{
+    SignonAuthService *asrv;
+    SignonIdentityFilter *filter;
+    SignonIdentityList *identity_list = NULL;
+    SignonIdentityInfo *info;
+    guint id;
+
+    g_debug("%s", G_STRFUNC);
+
+    id = new_identity ();
+    fail_unless (id != 0);
+
+    asrv = signon_auth_service_new ();
+
+    /* the filtered fields are not among the retrieved ones: they must still
+     * be checked, and not decoded */
+    filter = signon_identity_filter_new ();
+    signon_identity_filter_set_id_range (filter, id, id);
+    signon_identity_filter_set_method (filter, "ssotest");
+    signon_auth_service_query_identities_with_fields (asrv, filter, NULL,
+                                                      SIGNON_IDENTITY_INFO_FIELD_CAPTION,
+                                                      query_identities_filtered_cb,
+                                                      &identity_list);
+    _run_mainloop ();
+    signon_identity_filter_free (filter);
+
+    fail_unless (g_list_length (identity_list) == 1,
+                 "Wrong number of identities");
+    info = identity_list->data;
+    fail_unless (g_strcmp0 (signon_identity_info_get_caption (info),
+                            "MI-6") == 0, "Wrong caption in identity");
+    fail_unless (signon_identity_info_get_id (info) == 0,
+                 "Unrequested field was decoded");
+    g_list_free_full (identity_list,
+                      (GDestroyNotify) signon_identity_info_free);
+
+    /* a filter on a field the identity doesn't match leaves it out */
+    identity_list = NULL;
+    filter = signon_identity_filter_new ();
+    signon_identity_filter_set_id_range (filter, id, id);
+    signon_identity_filter_set_method (filter, "nonexisting");
+    signon_auth_service_query_identities_with_fields (asrv, filter, NULL,
+                                                      SIGNON_IDENTITY_INFO_FIELD_CAPTION,
+                                                      query_identities_filtered_cb,
+                                                      &identity_list);
+    _run_mainloop ();
+    signon_identity_filter_free (filter);
+
+    fail_unless (identity_list == NULL, "Identity should be filtered out");
+
+    g_object_unref (asrv);
+}
+END_TEST
+
+static void
+get_identities_cb (GObject *source_object,
+                   GAsyncResult *res,
+                   gpointer user_data)
+{
+    GPtrArray **identities = user_data;
+    GError *error = NULL;
+
+    *identities =
+        signon_auth_service_get_identities_finish (SIGNON_AUTH_SERVICE (source_object),
+                                                   res, &error);
+    fail_unless (error == NULL, "There should be no error in callback");
+    _stop_mainloop ();
+}
+
+static void
+get_identities_info_cb (SignonIdentity *self,
+                        SignonIdentityInfo *info,
+                        const GError *error,
+                        gpointer user_data)
+{
+    SignonIdentityInfo **result = user_data;
+
+    fail_unless (error == NULL, "There should be no error in callback");
+    *result = signon_identity_info_copy (info);
+    _stop_mainloop ();
+}
+
+START_TEST(test_get_identities)
+{
+    SignonAuthService *asrv;
+    GPtrArray *identities = NULL;
+    SignonIdentity *idty;
+    SignonIdentityInfo *info;
+    guint32 ids[3];
+
+    g_debug("%s", G_STRFUNC);
+
+    ids[0] = new_identity ();
+    ids[1] = new_identity ();
+    ids[2] = G_MAXINT32;
+    fail_unless (ids[0] != 0 && ids[1] != 0);
+
+    asrv = signon_auth_service_new ();
+
+    signon_auth_service_get_identities_async (asrv, ids, G_N_ELEMENTS (ids),
+                                              NULL, NULL,
+                                              get_identities_cb,
+                                              &identities);
+    _run_mainloop ();
+
+    fail_unless (identities != NULL, "No identities returned");
+    fail_unless (identities->len == G_N_ELEMENTS (ids),
+                 "Wrong number of identities");
+
+    /* the identities come in the order of the IDs */
+    idty = g_ptr_array_index (identities, 0);
+    fail_unless (SIGNON_IS_IDENTITY (idty));
+    info = NULL;
+    signon_identity_query_info (idty, get_identities_info_cb, &info);
+    _run_mainloop ();
+    fail_unless (info != NULL, "No info for the identity");
+    fail_unless (signon_identity_info_get_id (info) == (gint)ids[0],
+                 "Wrong identity at index 0");
+    fail_unless (g_strcmp0 (signon_identity_info_get_caption (info),
+                            "MI-6") == 0, "Wrong caption in identity");
+    signon_identity_info_free (info);
+
+    idty = g_ptr_array_index (identities, 1);
+    fail_unless (SIGNON_IS_IDENTITY (idty));
+
+    fail_unless (g_ptr_array_index (identities, 2) == NULL,
+                 "A missing identity must be NULL");
+
+    g_ptr_array_unref (identities);
+
+    /* no IDs at all still completes */
+    identities = NULL;
+    signon_auth_service_get_identities_async (asrv, NULL, 0, NULL, NULL,
+                                              get_identities_cb,
+                                              &identities);
+    _run_mainloop ();
+
+    fail_unless (identities != NULL && identities->len == 0);
+    g_ptr_array_unref (identities);
+
+    g_object_unref (asrv);
+}
+END_TEST
+
+START_TEST(test_prewarm)
+{
+    SignonIdentity *idty, *idty2;
+    SignonIdentityInfo *info;
+    guint32 id;
+
+    g_debug("%s", G_STRFUNC);
+
+    id = new_identity ();
+    fail_unless (id != 0);
+
+    /* nothing to resolve: only the connection is set up */
+    signon_auth_service_prewarm (NULL, 0, NULL);
+
+    signon_auth_service_prewarm (&id, 1, NULL);
+    /* prewarming twice doesn't resolve the identity twice */
+    signon_auth_service_prewarm (&id, 1, NULL);
+
+    g_timeout_add (500, test_quit_main_loop_cb, main_loop);
+    _run_mainloop ();
+
+    /* the first identity for the ID is the resolved one, the next are new */
+    idty = signon_identity_new_from_db (id);
+    fail_unless (SIGNON_IS_IDENTITY (idty));
+    idty2 = signon_identity_new_from_db (id);
+    fail_unless (SIGNON_IS_IDENTITY (idty2));
+    fail_unless (idty != idty2, "Prewarmed identity handed out twice");
+
+    info = NULL;
+    signon_identity_query_info (idty, get_identities_info_cb, &info);
+    _run_mainloop ();
+    fail_unless (info != NULL, "No info for the identity");
+    fail_unless (signon_identity_info_get_id (info) == (gint)id,
+                 "Wrong prewarmed identity");
+    fail_unless (g_strcmp0 (signon_identity_info_get_caption (info),
+                            "MI-6") == 0, "Wrong caption in identity");
+    signon_identity_info_free (info);
+
+    info = NULL;
+    signon_identity_query_info (idty2, get_identities_info_cb, &info);
+    _run_mainloop ();
+    fail_unless (info != NULL, "No info for the identity");
+    fail_unless (signon_identity_info_get_id (info) == (gint)id);
+    signon_identity_info_free (info);
+
+    g_object_unref (idty2);
+    g_object_unref (idty);
+}
+END_TEST
+
+static void
+query_identities_stream_cb (SignonAuthService *auth_service,
+                            SignonIdentityInfo *info,
+                            const GError *error,
+                            gpointer user_data)
+{
+    GArray *ids = user_data;
+    guint32 id;
+
+    fail_unless (error == NULL, "There should be no error in callback");
+    if (info == NULL)
+    {
+        _stop_mainloop ();
+        return;
+    }
+
+    id = signon_identity_info_get_id (info);
+    g_array_append_val (ids, id);
+}
+
+static GArray *
+query_identities_stream (SignonAuthService *asrv,
+                         guint32 min_id, guint32 max_id,
+                         guint offset, guint limit)
+{
+    SignonIdentityFilter *filter;
+    GArray *ids;
+
+    ids = g_array_new (FALSE, FALSE, sizeof (guint32));
+    filter = signon_identity_filter_new ();
+    signon_identity_filter_set_id_range (filter, min_id, max_id);
+    signon_auth_service_query_identities_stream (asrv, filter, NULL,
+                                                 offset, limit,
+                                                 query_identities_stream_cb,
+                                                 ids);
+    signon_identity_filter_free (filter);
+    _run_mainloop ();
+
+    return ids;
+}
+
+START_TEST(test_query_identities_stream)
+{
+    SignonAuthService *asrv;
+    GArray *all, *window;
+    guint32 ids[3];
+    guint i;
+
+    g_debug("%s", G_STRFUNC);
+
+    for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    {
+        ids[i] = new_identity ();
+        fail_unless (ids[i] != 0);
+    }
+
+    asrv = signon_auth_service_new ();
+
+    all = query_identities_stream (asrv, ids[0], ids[2], 0, 0);
+    fail_unless (all->len == 3, "Wrong number of identities");
+
+    /* a window in the middle */
+    window = query_identities_stream (asrv, ids[0], ids[2], 1, 1);
+    fail_unless (window->len == 1, "Limit was not applied");
+    fail_unless (g_array_index (window, guint32, 0) ==
+                 g_array_index (all, guint32, 1), "Offset was not applied");
+    g_array_unref (window);
+
+    /* a limit beyond the end */
+    window = query_identities_stream (asrv, ids[0], ids[2], 1, 10);
+    fail_unless (window->len == 2, "Wrong number of identities");
+    fail_unless (g_array_index (window, guint32, 0) ==
+                 g_array_index (all, guint32, 1));
+    fail_unless (g_array_index (window, guint32, 1) ==
+                 g_array_index (all, guint32, 2));
+    g_array_unref (window);
+
+    /* an offset beyond the end */
+    window = query_identities_stream (asrv, ids[0], ids[2], 3, 0);
+    fail_unless (window->len == 0, "Offset was not applied");
+    g_array_unref (window);
+
+    g_array_unref (all);
+    g_object_unref (asrv);
+}
+END_TEST
+
 static void
 test_regression_unref_process_cb (SignonAuthSession *self,
                                   GHashTable *reply,
@@ -1415,6 +2336,57 @@ test_regression_unref_process_cb (SignonAuthSession *self,
     _stop_mainloop ();
 }
 
+static void
+identity_changed_cb (SignonAuthService *auth_service,
+                     SignonIdentityChangeType type,
+                     guint id,
+                     guint sequence,
+                     gpointer user_data)
+{
+    SignonIdentityChange *last = user_data;
+
+    fail_unless (sequence > last->sequence);
+
+    last->sequence = sequence;
+    last->type = type;
+    last->id = id;
+}
+
+START_TEST(test_identity_changes)
+{
+    g_debug("%s", G_STRFUNC);
+    SignonAuthService *asrv = signon_auth_service_new ();
+    SignonIdentityChange last = { 0, 0, 0 };
+    SignonIdentityChange *change;
+    GArray *changes;
+    guint sequence;
+    guint id;
+
+    sequence = signon_auth_service_get_identity_change_sequence (asrv);
+    last.sequence = sequence;
+    g_signal_connect (asrv, "identity-changed",
+                      G_CALLBACK (identity_changed_cb), &last);
+
+    id = new_identity ();
+    fail_unless (id != 0);
+
+    fail_unless (last.sequence > sequence, "No change was reported");
+    fail_unless (last.type == SIGNON_IDENTITY_CHANGE_ADDED);
+    fail_unless (last.id == id);
+
+    changes = signon_auth_service_get_identity_changes (asrv, sequence);
+    fail_unless (changes != NULL);
+    fail_unless (changes->len > 0);
+    change = &g_array_index (changes, SignonIdentityChange, 0);
+    fail_unless (change->sequence == sequence + 1);
+    fail_unless (change->type == SIGNON_IDENTITY_CHANGE_ADDED);
+    fail_unless (change->id == id);
+    g_array_free (changes, TRUE);
+
+    g_object_unref (asrv);
+}
+END_TEST
+
 START_TEST(test_regression_unref)
 {
     SignonIdentity *idty;
@@ -1469,23 +2441,37 @@ signon_suite(void)
      * */
     tcase_set_timeout(tc_core, 1080);
     tcase_add_test (tc_core, test_init);
+    tcase_add_test (tc_core, test_init_async);
     tcase_add_test (tc_core, test_query_methods);
 
     tcase_add_test (tc_core, test_query_mechanisms);
     tcase_add_test (tc_core, test_get_existing_identity);
     tcase_add_test (tc_core, test_get_nonexisting_identity);
+    tcase_add_test (tc_core, test_get_shared_identity);
 
     tcase_add_test (tc_core, test_auth_session_creation);
+    tcase_add_test (tc_core, test_auth_session_limit);
     tcase_add_test (tc_core, test_auth_session_query_mechanisms);
     tcase_add_test (tc_core, test_auth_session_query_mechanisms_nonexisting);
     tcase_add_test (tc_core, test_auth_session_process);
     tcase_add_test (tc_core, test_auth_session_process_failure);
+    tcase_add_test (tc_core, test_auth_session_process_queue);
+    tcase_add_test (tc_core, test_auth_session_process_batch);
+    tcase_add_test (tc_core, test_auth_session_shared_requests);
+    tcase_add_test (tc_core, test_auth_session_result_cache);
+    tcase_add_test (tc_core, test_auth_session_result_cache_invalidation);
     tcase_add_test (tc_core, test_auth_session_process_after_store);
     tcase_add_test (tc_core, test_store_credentials_identity);
     tcase_add_test (tc_core, test_remove_identity);
     tcase_add_test (tc_core, test_info_identity);
 
     tcase_add_test (tc_core, test_query_identities);
+    tcase_add_test (tc_core, test_query_identities_with_fields);
+    tcase_add_test (tc_core, test_query_identities_filtered_fields);
+    tcase_add_test (tc_core, test_get_identities);
+    tcase_add_test (tc_core, test_prewarm);
+    tcase_add_test (tc_core, test_query_identities_stream);
+    tcase_add_test (tc_core, test_identity_changes);
 
     tcase_add_test (tc_core, test_signout_identity);
     tcase_add_test (tc_core, test_unregistered_identity);